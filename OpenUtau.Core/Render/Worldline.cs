@@ -17,6 +17,19 @@ public class CutOffExceedDurationError : SynthRequestError { }
     public class CutOffBeforeOffsetError : SynthRequestError { }
 
     public static class Worldline {
+        // When set, f0 of samples without a frq file is written next to them
+        // as <name>_wav.frq, so that later renders skip f0 estimation.
+        public static bool WriteBackFrq = false;
+
+        [DllImport("worldline")]
+        static extern void F0SetPyinMethod(int method);
+
+        // Estimates f0 of samples without a frq file with the FFT-based pyin
+        // instead of libpyin. Applies to all later renders.
+        public static void SetFastPyin(bool fast) {
+            F0SetPyinMethod(fast ? 1 : 0);
+        }
+
         [DllImport("worldline", CallingConvention = CallingConvention.Cdecl)]
         static extern int F0(
             float[] samples, int length, int fs, double framePeriod, int method, ref IntPtr f0);
@@ -234,20 +247,111 @@ struct SynthRequest {
             public int flag_Mt;
             public int flag_Mb;
             public int flag_Mv;
+            // 0 for final, 1 for preview.
+            public int quality;
+            // MIDI tone the sample was recorded at, or 0 if unknown.
+            public int sample_tone;
+            // Null-terminated UTF-8 path to write the frq to, or null.
+            public IntPtr frq_write_path;
+            // Handle from SampleStoreLoad, read in place of sample, or 0.
+            public long sample_handle;
         };
 
+        [DllImport("worldline", CallingConvention = CallingConvention.Cdecl)]
+        static extern long SampleStoreLoad(
+            [MarshalAs(UnmanagedType.LPUTF8Str)] string path, out int fs, out int length);
+
+        [DllImport("worldline", CallingConvention = CallingConvention.Cdecl)]
+        static extern int SampleStoreRetain(long handle);
+
+        [DllImport("worldline", CallingConvention = CallingConvention.Cdecl)]
+        static extern void SampleStoreRelease(long handle);
+
+        // Samples stay decoded in the native store while a handle refers to
+        // them. Besides the handle of each request, one is retained for each
+        // of the most recently used files, so that notes of the same sample
+        // share one decode.
+        const int RetainedSamples = 64;
+        static readonly object retainedLock = new object();
+        static readonly LinkedList<(string path, long handle)> retainedOrder
+            = new LinkedList<(string path, long handle)>();
+        static readonly Dictionary<string, LinkedListNode<(string path, long handle)>> retained
+            = new Dictionary<string, LinkedListNode<(string path, long handle)>>();
+
+        // Returns a handle owned by the caller, or 0 if the native reader does
+        // not support the file.
+        static long LoadSample(string path, out int fs, out int length) {
+            long handle = SampleStoreLoad(path, out fs, out length);
+            if (handle == 0) {
+                return 0;
+            }
+            lock (retainedLock) {
+                if (retained.TryGetValue(path, out var node)) {
+                    retainedOrder.Remove(node);
+                    if (node.Value.handle == handle) {
+                        retainedOrder.AddFirst(node);
+                        return handle;
+                    }
+                    // The file changed since it was retained.
+                    retained.Remove(path);
+                    SampleStoreRelease(node.Value.handle);
+                }
+                // A second reference to the same decode, not another load.
+                if (SampleStoreRetain(handle) != 0) {
+                    retained[path] = retainedOrder.AddFirst((path, handle));
+                }
+                while (retainedOrder.Count > RetainedSamples) {
+                    var last = retainedOrder.Last;
+                    retainedOrder.RemoveLast();
+                    retained.Remove(last.Value.path);
+                    SampleStoreRelease(last.Value.handle);
+                }
+            }
+            return handle;
+        }
+
+        // Frees the samples retained for later requests, of files under
+        // directory, or all of them if it is null. Called when voicebanks are
+        // reloaded or unloaded.
+        public static void ReleaseSamples(string? directory = null) {
+            string? prefix = directory == null ? null
+                : Path.TrimEndingDirectorySeparator(Path.GetFullPath(directory))
+                    + Path.DirectorySeparatorChar;
+            lock (retainedLock) {
+                var node = retainedOrder.First;
+                while (node != null) {
+                    var next = node.Next;
+                    if (prefix == null || Path.GetFullPath(node.Value.path).StartsWith(
+                            prefix, StringComparison.OrdinalIgnoreCase)) {
+                        retainedOrder.Remove(node);
+                        retained.Remove(node.Value.path);
+                        SampleStoreRelease(node.Value.handle);
+                    }
+                    node = next;
+                }
+            }
+        }
+
         class SynthRequestWrapper : IDisposable {
             public SynthRequest request;
             private bool disposedValue;
             private GCHandle[] handles;
+            private long sampleHandle;
 
             public SynthRequestWrapper(ResamplerItem item) {
+                // Decoded natively once and shared by requests of the same
+                // file. NAudio remains for formats the native reader lacks.
                 int fs;
-                double[] sample;
-                using (var waveStream = Wave.OpenFile(item.inputFile)) {
-                    fs = waveStream.WaveFormat.SampleRate;
-                    sample = Wave.GetSamples(waveStream.ToSampleProvider().ToMono(1, 0))
-                        .Select(f => (double)f).ToArray();
+                int sampleLength;
+                double[]? sample = null;
+                sampleHandle = LoadSample(item.inputFile, out fs, out sampleLength);
+                if (sampleHandle == 0) {
+                    using (var waveStream = Wave.OpenFile(item.inputFile)) {
+                        fs = waveStream.WaveFormat.SampleRate;
+                        sample = Wave.GetSamples(waveStream.ToSampleProvider().ToMono(1, 0))
+                            .Select(f => (double)f).ToArray();
+                    }
+                    sampleLength = sample.Length;
                 }
                 string frqFile = VoicebankFiles.GetFrqFile(item.inputFile);
                 GCHandle? pinnedFrq = null;
@@ -262,15 +366,32 @@ class SynthRequestWrapper : IDisposable {
                     }
                 }
 
-                var pinnedSample = GCHandle.Alloc(sample, GCHandleType.Pinned);
+                GCHandle? pinnedFrqPath = null;
+                if (frq == null && WriteBackFrq) {
+                    var path = System.Text.Encoding.UTF8.GetBytes(frqFile + "\0");
+                    pinnedFrqPath = GCHandle.Alloc(path, GCHandleType.Pinned);
+                }
+
+                GCHandle? pinnedSample = null;
+                if (sample != null) {
+                    pinnedSample = GCHandle.Alloc(sample, GCHandleType.Pinned);
+                }
                 var pinnedPitchBend = GCHandle.Alloc(item.pitches, GCHandleType.Pinned);
-                handles = pinnedFrq == null
-                    ? new[] { pinnedSample, pinnedPitchBend }
-                    : new[] { pinnedSample, pinnedPitchBend, pinnedFrq.Value };
+                var pinned = new List<GCHandle> { pinnedPitchBend };
+                if (pinnedSample != null) {
+                    pinned.Add(pinnedSample.Value);
+                }
+                if (pinnedFrq != null) {
+                    pinned.Add(pinnedFrq.Value);
+                }
+                if (pinnedFrqPath != null) {
+                    pinned.Add(pinnedFrqPath.Value);
+                }
+                handles = pinned.ToArray();
                 request = new SynthRequest {
                     sample_fs = fs,
-                    sample_length = sample.Length,
-                    sample = pinnedSample.AddrOfPinnedObject(),
+                    sample_length = sampleLength,
+                    sample = pinnedSample?.AddrOfPinnedObject() ?? IntPtr.Zero,
                     frq_length = frq?.Length ?? 0,
                     frq = pinnedFrq?.AddrOfPinnedObject() ?? IntPtr.Zero,
                     tone = item.tone,
@@ -290,6 +411,9 @@ class SynthRequestWrapper : IDisposable {
                     flag_Mt = 0,
                     flag_Mb = 0,
                     flag_Mv = 100,
+                    frq_write_path = pinnedFrqPath?.AddrOfPinnedObject() ?? IntPtr.Zero,
+                    sample_handle = sampleHandle,
+                    sample_tone = SampleTone(item.phone.oto),
                 };
                 var flag = item.flags.FirstOrDefault(f => f.Item1 == "g");
                 if (flag != null && flag.Item2.HasValue) {
@@ -317,6 +441,28 @@ class SynthRequestWrapper : IDisposable {
                 }
                 Validate(request);
             }
+            // MIDI tone the sample was recorded at, from a pitch label ending
+            // the subbank suffix or the folder of the wav, e.g. "_C4" or
+            // "normal_A#3", or 0 if there is none.
+            static int SampleTone(OpenUtau.Core.Ustx.UOto oto) {
+                var labels = new List<string>();
+                if (oto?.Subbanks != null && oto.Subbanks.Length > 0) {
+                    labels.Add(oto.Subbanks[0].Suffix);
+                }
+                if (!string.IsNullOrEmpty(oto?.File)) {
+                    labels.Add(Path.GetFileName(Path.GetDirectoryName(oto.File)));
+                }
+                foreach (var label in labels) {
+                    if (string.IsNullOrEmpty(label)) {
+                        continue;
+                    }
+                    int tone = MusicMath.NameToTone(label.Split(' ', '_', '-').Last());
+                    if (tone > 0 && tone < 128) {
+                        return tone;
+                    }
+                }
+                return 0;
+            }
             static void Validate(SynthRequest request) {
                 int frame_ms = 10;
                 var total_ms = 1000.0 * request.sample_length / request.sample_fs;
@@ -339,6 +485,9 @@ class SynthRequestWrapper : IDisposable {
                     foreach (var handle in handles) {
                         handle.Free();
                     }
+                    if (sampleHandle != 0) {
+                        SampleStoreRelease(sampleHandle);
+                    }
                     disposedValue = true;
                 }
             }
@@ -375,15 +524,63 @@ class SynthRequestWrapper : IDisposable {
         [DllImport("worldline")]
         static extern IntPtr PhraseSynthNew();
 
+        [DllImport("worldline")]
+        static extern IntPtr PhraseSynthNewFolding();
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct PhraseSynthMemoryStats {
+            public long bytes;
+            public long peakBytes;
+            // Process-wide, shared by all phrases.
+            public long cacheBytes;
+            public long poolBytes;
+            public long pendingUpgrades;
+            public long upgradeBytes;
+        }
+
+        [DllImport("worldline")]
+        static extern void PhraseSynthGetMemoryStats(
+            IntPtr phrase_synth, ref PhraseSynthMemoryStats stats);
+
         [DllImport("worldline")]
         static extern void PhraseSynthDelete(IntPtr phrase_synth);
 
         [DllImport("worldline")]
-        static extern void PhraseSynthAddRequest(
+        static extern int PhraseSynthSetQuality(
+            IntPtr phrase_synth, int quality, int upgrade);
+
+        [DllImport("worldline")]
+        static extern int PhraseSynthAddRequest(
             IntPtr phrase_synth, IntPtr request,
             double posMs, double skipMs, double lengthMs,
             double fadeInMs, double fadeOutMs, LogCallback logCallback);
 
+        [StructLayout(LayoutKind.Sequential)]
+        public struct RequestTiming {
+            public double posMs;
+            public double skipMs;
+            public double lengthMs;
+            public double fadeInMs;
+            public double fadeOutMs;
+        }
+
+        [DllImport("worldline")]
+        static extern int PhraseSynthAddRequests(
+            IntPtr phrase_synth, SynthRequest[] requests,
+            RequestTiming[] timings, int count, LogCallback logCallback);
+
+        [DllImport("worldline")]
+        static extern int PhraseSynthReplaceRequest(
+            IntPtr phrase_synth, int id, IntPtr request,
+            ref RequestTiming timing, LogCallback logCallback);
+
+        [DllImport("worldline")]
+        static extern int PhraseSynthRemoveRequest(IntPtr phrase_synth, int id);
+
+        [DllImport("worldline")]
+        static extern int PhraseSynthUpdateTiming(
+            IntPtr phrase_synth, int id, ref RequestTiming timing);
+
         [DllImport("worldline")]
         static extern void PhraseSynthSetCurves(
             IntPtr phraseSynth, double[] f0,
@@ -396,12 +593,23 @@ class SynthRequestWrapper : IDisposable {
             IntPtr phrase_synth,
             ref IntPtr y, LogCallback logCallback);
 
+        [DllImport("worldline")]
+        static extern int PhraseSynthBeginStream(
+            IntPtr phrase_synth, LogCallback logCallback);
+
+        [DllImport("worldline")]
+        static extern int PhraseSynthRead(
+            IntPtr phrase_synth, float[] buf, int n);
+
         public class PhraseSynth : IDisposable {
             private IntPtr ptr;
             private bool disposedValue;
 
-            public PhraseSynth() {
-                ptr = PhraseSynthNew();
+            // With foldOnAdd, notes are folded into the phrase as they are
+            // added, which bounds memory but disables ReplaceRequest,
+            // RemoveRequest and UpdateTiming.
+            public PhraseSynth(bool foldOnAdd = false) {
+                ptr = foldOnAdd ? PhraseSynthNewFolding() : PhraseSynthNew();
             }
 
             protected virtual void Dispose(bool disposing) {
@@ -420,14 +628,16 @@ public class PhraseSynth : IDisposable {
                 GC.SuppressFinalize(this);
             }
 
-            public void AddRequest(
+            // Returns the id of the request, for ReplaceRequest, RemoveRequest
+            // and UpdateTiming.
+            public int AddRequest(
                 ResamplerItem item, double posMs, double skipMs,
                 double lengthMs, double fadeInMs, double fadeOutMs) {
                 var requestWrapper = new SynthRequestWrapper(item);
                 SynthRequest request = requestWrapper.request;
                 try {
                     unsafe {
-                        PhraseSynthAddRequest(
+                        return PhraseSynthAddRequest(
                             ptr, new IntPtr(&request),
                             posMs, skipMs, lengthMs,
                             fadeInMs, fadeOutMs, Log.Information);
@@ -437,6 +647,45 @@ public class PhraseSynth : IDisposable {
                 }
             }
 
+            // Returns the id of the first item, the others follow consecutively.
+            public int AddRequests(ResamplerItem[] items, RequestTiming[] timings) {
+                var wrappers = new List<SynthRequestWrapper>();
+                try {
+                    foreach (var item in items) {
+                        wrappers.Add(new SynthRequestWrapper(item));
+                    }
+                    var requests = wrappers.Select(w => w.request).ToArray();
+                    return PhraseSynthAddRequests(
+                        ptr, requests, timings, requests.Length, Log.Information);
+                } finally {
+                    foreach (var wrapper in wrappers) {
+                        wrapper.Dispose();
+                    }
+                }
+            }
+
+            public bool ReplaceRequest(int id, ResamplerItem item, RequestTiming timing) {
+                var requestWrapper = new SynthRequestWrapper(item);
+                SynthRequest request = requestWrapper.request;
+                try {
+                    unsafe {
+                        return PhraseSynthReplaceRequest(
+                            ptr, id, new IntPtr(&request),
+                            ref timing, Log.Information) != 0;
+                    }
+                } finally {
+                    requestWrapper.Dispose();
+                }
+            }
+
+            public bool RemoveRequest(int id) {
+                return PhraseSynthRemoveRequest(ptr, id) != 0;
+            }
+
+            public bool UpdateTiming(int id, RequestTiming timing) {
+                return PhraseSynthUpdateTiming(ptr, id, ref timing) != 0;
+            }
+
             public void SetCurves(
                 double[] f0, double[] gender,
                 double[] tension, double[] breathiness,
@@ -455,6 +704,30 @@ public class PhraseSynth : IDisposable {
                 Marshal.FreeCoTaskMem(buffer);
                 return data;
             }
+
+            // Preview analysis is cheaper. With upgrade, preview notes are
+            // also analyzed at final quality in the background, so that a later
+            // final render finds them in the analysis cache. Must be called
+            // before adding requests.
+            public bool SetQuality(bool preview, bool upgrade = false) {
+                return PhraseSynthSetQuality(ptr, preview ? 1 : 0, upgrade ? 1 : 0) != 0;
+            }
+
+            public PhraseSynthMemoryStats GetMemoryStats() {
+                var stats = new PhraseSynthMemoryStats();
+                PhraseSynthGetMemoryStats(ptr, ref stats);
+                return stats;
+            }
+
+            // Starts streaming synthesis. Returns the total number of samples.
+            public int BeginStream() {
+                return PhraseSynthBeginStream(ptr, Log.Information);
+            }
+
+            // Reads the next samples into buffer. Returns 0 at the end.
+            public int Read(float[] buffer) {
+                return PhraseSynthRead(ptr, buffer, buffer.Length);
+            }
         }
 
         class SynthSegment {
@@ -7,6 +7,7 @@
 using System.Threading;
 using System.Threading.Tasks;
 using OpenUtau.Classic;
+using OpenUtau.Core.Render;
 using OpenUtau.Core.Ustx;
 using OpenUtau.Core.Util;
 using Serilog;
@@ -27,6 +28,7 @@ public class SingerManager : SingletonBase<SingerManager> {
 
         public void SearchAllSingers() {
             Log.Information("Searching singers.");
+            Worldline.ReleaseSamples();
             Directory.CreateDirectory(PathManager.Inst.SingersPath);
             var stopWatch = Stopwatch.StartNew();
             var singers = ClassicSingerLoader.FindAllSingers()
@@ -87,6 +89,7 @@ public class SingerManager : SingletonBase<SingerManager> {
                     retries--;
                     try {
                         singer.Reload();
+                        Worldline.ReleaseSamples(singer.Location);
                         break;
                     } catch (Exception e) {
                         if (retries == 0) {
@@ -119,6 +122,9 @@ public class SingerManager : SingletonBase<SingerManager> {
             foreach (var singer in singersUsed) {
                 if (!singersInUse.Contains(singer)) {
                     singer.FreeMemory();
+                    if (!string.IsNullOrEmpty(singer.Location)) {
+                        Worldline.ReleaseSamples(singer.Location);
+                    }
                 }
             }
             //Update singers used
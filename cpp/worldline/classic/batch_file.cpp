@@ -0,0 +1,241 @@
+#include "batch_file.h"
+
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+
+namespace worldline {
+
+// Depth of nested call lines, deeper ones are taken as recursion.
+constexpr int kMaxCallDepth = 4;
+
+namespace {
+
+// Keyed by lowercase names, as batch variables are case insensitive.
+using Variables = std::unordered_map<std::string, std::string>;
+using Calls = std::vector<std::vector<std::string>>;
+
+std::string Dequote(std::string_view token) {
+  std::string result;
+  for (char c : token) {
+    if (c != '"') {
+      result.push_back(c);
+    }
+  }
+  return result;
+}
+
+// Absolute on either Windows or POSIX, since batch files come from Windows
+// hosts but may be rendered elsewhere.
+bool IsAbsolutePath(std::string_view path) {
+  return (path.size() >= 2 && path[1] == ':') ||
+         (!path.empty() && (path[0] == '\\' || path[0] == '/'));
+}
+
+// Applies the modifiers of %~<modifiers><digit>, e.g. n in %~n1.
+std::string ApplyModifiers(std::string_view modifiers,
+                           const std::string& param) {
+  std::filesystem::path path(Dequote(param));
+  if (modifiers.empty()) {
+    return path.string();
+  }
+  std::string result;
+  for (char modifier : modifiers) {
+    switch (std::tolower(static_cast<unsigned char>(modifier))) {
+      case 'f':
+        return std::filesystem::absolute(path).string();
+      case 'd':
+        result += path.root_name().string();
+        break;
+      case 'p':
+        result += path.parent_path().relative_path().string();
+        break;
+      case 'n':
+        result += path.stem().string();
+        break;
+      case 'x':
+        result += path.extension().string();
+        break;
+    }
+  }
+  return result;
+}
+
+// Expands %name%, %0 to %9, %~0 to %~9 with modifiers, and %%.
+// Undefined names expand to nothing, as in batch files.
+std::string Expand(std::string_view line, const Variables& variables,
+                   const std::vector<std::string>& params) {
+  auto param = [&](char digit) -> std::string {
+    int index = digit - '0';
+    return index < params.size() ? params[index] : "";
+  };
+  std::string result;
+  std::size_t i = 0;
+  while (i < line.size()) {
+    if (line[i] != '%' || i + 1 >= line.size()) {
+      result.push_back(line[i++]);
+      continue;
+    }
+    char next = line[i + 1];
+    if (next == '%') {
+      result.push_back('%');
+      i += 2;
+      continue;
+    }
+    if (std::isdigit(static_cast<unsigned char>(next))) {
+      result += param(next);
+      i += 2;
+      continue;
+    }
+    if (next == '~') {
+      std::size_t end = i + 2;
+      while (end < line.size() &&
+             std::isalpha(static_cast<unsigned char>(line[end]))) {
+        end++;
+      }
+      if (end < line.size() &&
+          std::isdigit(static_cast<unsigned char>(line[end]))) {
+        result += ApplyModifiers(line.substr(i + 2, end - i - 2),
+                                 param(line[end]));
+        i = end + 1;
+        continue;
+      }
+    }
+    std::size_t close = line.find('%', i + 1);
+    if (close == std::string_view::npos) {
+      result.push_back(line[i++]);
+      continue;
+    }
+    auto value = variables.find(
+        absl::AsciiStrToLower(line.substr(i + 1, close - i - 1)));
+    if (value != variables.end()) {
+      result += value->second;
+    }
+    i = close + 1;
+  }
+  return result;
+}
+
+// Splits at spaces outside of quotes. Quotes are kept in tokens, as call
+// passes them on to %1 and the like.
+std::vector<std::string> Tokenize(std::string_view line) {
+  std::vector<std::string> tokens;
+  std::string token;
+  bool quoted = false;
+  bool in_token = false;
+  for (char c : line) {
+    if (c == '"') {
+      quoted = !quoted;
+      in_token = true;
+      token.push_back(c);
+    } else if ((c == ' ' || c == '\t') && !quoted) {
+      if (in_token) {
+        tokens.push_back(token);
+        token.clear();
+        in_token = false;
+      }
+    } else {
+      token.push_back(c);
+      in_token = true;
+    }
+  }
+  if (in_token) {
+    tokens.push_back(token);
+  }
+  return tokens;
+}
+
+std::string ResolvePath(const std::filesystem::path& dir,
+                        const std::string& path) {
+  if (path.empty() || IsAbsolutePath(path)) {
+    return path;
+  }
+  return (dir / path).string();
+}
+
+bool Interpret(const std::filesystem::path& file,
+               const std::filesystem::path& dir,
+               const std::vector<std::string>& params, int depth,
+               Variables* variables, Calls* calls) {
+  std::ifstream stream(file);
+  if (!stream.is_open()) {
+    return false;
+  }
+  std::string raw_line;
+  while (std::getline(stream, raw_line)) {
+    std::string_view line = absl::StripAsciiWhitespace(raw_line);
+    while (!line.empty() && line[0] == '@') {
+      line = absl::StripLeadingAsciiWhitespace(line.substr(1));
+    }
+    if (absl::StartsWithIgnoreCase(line, "set ")) {
+      std::string assignment = Expand(
+          absl::StripLeadingAsciiWhitespace(line.substr(4)), *variables,
+          params);
+      std::size_t equals = assignment.find('=');
+      if (equals == std::string::npos) {
+        continue;
+      }
+      std::string name = absl::AsciiStrToLower(
+          absl::StripAsciiWhitespace(assignment.substr(0, equals)));
+      std::string value = assignment.substr(equals + 1);
+      if (value.empty()) {
+        variables->erase(name);
+      } else {
+        (*variables)[name] = value;
+      }
+      continue;
+    }
+
+    std::vector<std::string> tokens =
+        Tokenize(Expand(line, *variables, params));
+    if (!tokens.empty() && absl::EqualsIgnoreCase(tokens[0], "call")) {
+      tokens.erase(tokens.begin());
+      if (tokens.empty()) {
+        continue;
+      }
+      std::string target = Dequote(tokens[0]);
+      if (absl::EndsWithIgnoreCase(target, ".bat") ||
+          absl::EndsWithIgnoreCase(target, ".cmd")) {
+        if (depth < kMaxCallDepth) {
+          Interpret(ResolvePath(dir, target), dir, tokens, depth + 1,
+                    variables, calls);
+        }
+        continue;
+      }
+    }
+    auto resampler = variables->find("resamp");
+    if (tokens.empty() || resampler == variables->end() ||
+        !absl::EqualsIgnoreCase(Dequote(tokens[0]),
+                                Dequote(resampler->second))) {
+      continue;
+    }
+    std::vector<std::string> args;
+    for (std::size_t i = 1; i < tokens.size(); ++i) {
+      args.push_back(Dequote(tokens[i]));
+    }
+    for (std::size_t i = 0; i < 2 && i < args.size(); ++i) {
+      args[i] = ResolvePath(dir, args[i]);
+    }
+    calls->push_back(std::move(args));
+  }
+  return true;
+}
+
+}  // namespace
+
+std::vector<std::vector<std::string>> ParseBatchFile(const std::string& path) {
+  std::filesystem::path file(path);
+  Variables variables;
+  Calls calls;
+  Interpret(file, file.parent_path(), {path}, 0, &variables, &calls);
+  return calls;
+}
+
+}  // namespace worldline
@@ -0,0 +1,20 @@
+#ifndef WORLDLINE_CLASSIC_BATCH_FILE_H_
+#define WORLDLINE_CLASSIC_BATCH_FILE_H_
+
+#include <string>
+#include <vector>
+
+namespace worldline {
+
+// Arguments of every resampler call of a temp.bat written by UTAU, in
+// order, for ParseClassicArgs. Resampler calls are the lines running
+// %resamp%, including those of batch files invoked with call such as
+// temp_helper.bat, which get the positional arguments of the call. Only
+// set, call and resampler lines are interpreted. Relative wav paths are
+// resolved against the directory of the batch file, where hosts run it.
+// Returns an empty list if the file cannot be read.
+std::vector<std::vector<std::string>> ParseBatchFile(const std::string& path);
+
+}  // namespace worldline
+
+#endif  // WORLDLINE_CLASSIC_BATCH_FILE_H_
@@ -0,0 +1,101 @@
+#include "worldline/classic/batch_file.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace worldline {
+namespace {
+
+class BatchFileTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    dir_ = std::filesystem::path(testing::TempDir()) / "batch_file_test";
+    std::filesystem::remove_all(dir_);
+    std::filesystem::create_directories(dir_);
+  }
+  void TearDown() override { std::filesystem::remove_all(dir_); }
+
+  std::string Write(const std::string& name, const std::string& content) {
+    std::filesystem::path path = dir_ / name;
+    std::ofstream(path, std::ios::binary) << content;
+    return path.string();
+  }
+
+  std::string InDir(const std::string& name) {
+    return (dir_ / name).string();
+  }
+
+  std::filesystem::path dir_;
+};
+
+TEST_F(BatchFileTest, ExpandsHelperCalls) {
+  // As written by UTAU, with the resampler called from the helper.
+  Write("temp_helper.bat",
+        "@if exist %temp% goto A\r\n"
+        "@\"%resamp%\" %1 %temp% %2 %vel% %flag% %5 %6 %7 %8 %params%\r\n"
+        ":A\r\n"
+        "@\"%tool%\" \"%output%\" %temp% %stp% %3 %env%\r\n");
+  std::string batch = Write(
+      "temp.bat",
+      "@set loadmodule=\r\n"
+      "@set tempo=120\r\n"
+      "@set oto=/voice\r\n"
+      "@set tool=/bin/wavtool\r\n"
+      "@set resamp=/bin/resampler\r\n"
+      "@set output=temp.wav\r\n"
+      "@set helper=temp_helper.bat\r\n"
+      "@set cachedir=temp.cache\r\n"
+      "@set flag=\"\"\r\n"
+      "@set stp=0\r\n"
+      "@del \"%output%\" 2>nul\r\n"
+      "@mkdir \"%cachedir%\" 2>nul\r\n"
+      "\r\n"
+      "@set params=100 0 !120 AA#5#\r\n"
+      "@set flag=\"g-5\"\r\n"
+      "@set env=0 5 35 0 100 100 0\r\n"
+      "@set vel=100\r\n"
+      "@set temp=\"%cachedir%\\1_ka_C4.wav\"\r\n"
+      "@echo ###\r\n"
+      "@call %helper% \"%oto%/ka a.wav\" C4 480@120+50.0 0 12.0 52.0 "
+      "-10.0 0 0\r\n"
+      "@set params=90 100 !120 AA\r\n"
+      "@set flag=\"\"\r\n"
+      "@set temp=\"%cachedir%\\2_ki_D4.wav\"\r\n"
+      "@call %helper% \"%oto%/ki.wav\" D4 240@120+0.0 0 5 0 20 0\r\n");
+
+  std::vector<std::vector<std::string>> calls = ParseBatchFile(batch);
+  ASSERT_EQ(calls.size(), 2);
+  EXPECT_EQ(calls[0],
+            (std::vector<std::string>{
+                "/voice/ka a.wav", InDir("temp.cache\\1_ka_C4.wav"), "C4",
+                "100", "g-5", "12.0", "52.0", "-10.0", "0", "100", "0", "!120",
+                "AA#5#"}));
+  EXPECT_EQ(calls[1],
+            (std::vector<std::string>{"/voice/ki.wav",
+                                      InDir("temp.cache\\2_ki_D4.wav"), "D4",
+                                      "100", "", "5", "0", "20", "0", "90",
+                                      "100", "!120", "AA"}));
+}
+
+TEST_F(BatchFileTest, ReadsDirectCalls) {
+  std::string batch = Write("render.bat",
+                            "set RESAMP=C:\\tools\\resampler.exe\n"
+                            "\"%Resamp%\" C:\\v\\a.wav out.wav A3 100\n"
+                            "C:\\tools\\other.exe a b c\n");
+  std::vector<std::vector<std::string>> calls = ParseBatchFile(batch);
+  ASSERT_EQ(calls.size(), 1);
+  EXPECT_EQ(calls[0], (std::vector<std::string>{"C:\\v\\a.wav",
+                                                InDir("out.wav"), "A3",
+                                                "100"}));
+}
+
+TEST_F(BatchFileTest, ReturnsNothingForMissingFile) {
+  EXPECT_TRUE(ParseBatchFile(InDir("missing.bat")).empty());
+}
+
+}  // namespace
+}  // namespace worldline
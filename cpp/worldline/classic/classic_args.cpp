@@ -1,9 +1,12 @@
 #include "classic_args.h"
 
+#include <algorithm>
 #include <cmath>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <string_view>
 
 #include "absl/strings/numbers.h"
 
@@ -21,7 +24,7 @@ static bool ParseTone(std::string_view name, int* tone) {
     return false;
   }
   int tone_index = name[0] - 'A';
-  if (tone_index >= 7) {
+  if (tone_index < 0 || tone_index >= 7 || (sharp && name[1] != '#')) {
     return false;
   }
   *tone = name_to_tone[tone_index];
@@ -177,9 +180,22 @@ SynthRequest ParseClassicArgs(const std::vector<std::string>& args) {
     std::copy(pitch_bend.begin(), pitch_bend.end(), pitch_bend_array);
     request.pitch_bend = pitch_bend_array;
   }
+  request.sample_tone = args.empty() ? 0 : SampleToneOfPath(args[0]);
   return request;
 }
 
+int SampleToneOfPath(const std::string& wav_path) {
+  std::string folder =
+      std::filesystem::u8path(wav_path).parent_path().filename().u8string();
+  std::string_view label = folder;
+  std::size_t space = label.find_last_of(" _-");
+  if (space != std::string_view::npos) {
+    label.remove_prefix(space + 1);
+  }
+  int tone;
+  return ParseTone(label, &tone) ? tone : 0;
+}
+
 void LogClassicArgs(const SynthRequest& request, const std::string& logfile) {
   std::ofstream f;
   f.open(logfile, std::ios::out | std::ios::app);
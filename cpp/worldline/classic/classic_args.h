@@ -8,8 +8,14 @@
 
 namespace worldline {
 
+// Also sets sample_tone, see SampleToneOfPath.
 SynthRequest ParseClassicArgs(const std::vector<std::string>& args);
 
+// MIDI tone of the pitch label naming the folder of a wav, alone or as its
+// last word, e.g. "C4/ka.wav" or "normal_A#3/ka.wav", as in voicebanks
+// recorded at several pitches. 0 if there is none.
+int SampleToneOfPath(const std::string& wav_path);
+
 void LogClassicArgs(const SynthRequest& request, const std::string& logfile);
 
 }  // namespace worldline
@@ -0,0 +1,30 @@
+#include "worldline/classic/classic_args.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace worldline {
+namespace {
+
+TEST(ClassicArgsTest, ParsesSampleToneOfFolder) {
+  EXPECT_EQ(SampleToneOfPath("vb/C4/ka.wav"), 60);
+  EXPECT_EQ(SampleToneOfPath("vb/normal_A#3/ka.wav"), 58);
+  EXPECT_EQ(SampleToneOfPath("vb/power G4/ka.wav"), 67);
+  EXPECT_EQ(SampleToneOfPath("vb/normal/ka.wav"), 0);
+  EXPECT_EQ(SampleToneOfPath("vb/C44/ka.wav"), 0);
+  EXPECT_EQ(SampleToneOfPath("vb/a4/ka.wav"), 0);
+  EXPECT_EQ(SampleToneOfPath("ka.wav"), 0);
+}
+
+TEST(ClassicArgsTest, SetsSampleTone) {
+  SynthRequest request =
+      ParseClassicArgs({"vb/D4/ka.wav", "out.wav", "E4", "100"});
+  EXPECT_EQ(request.tone, 64);
+  EXPECT_EQ(request.sample_tone, 62);
+  delete[] request.pitch_bend;
+}
+
+}  // namespace
+}  // namespace worldline
@@ -1,7 +1,15 @@
 #include "frq.h"
 
 #include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
 #include <vector>
 
 namespace worldline {
@@ -54,4 +62,49 @@ std::string DumpFrq(const FrqData& frq_data) {
   return result;
 }
 
+std::string FrqPath(const std::string& wav_path) {
+  std::size_t last_dot_index = wav_path.find_last_of('.');
+  if (last_dot_index == std::string::npos || last_dot_index == 0) {
+    return "";
+  }
+  return wav_path.substr(0, last_dot_index) + "_" +
+         wav_path.substr(last_dot_index + 1) + ".frq";
+}
+
+std::string ReadFrqFile(const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return "";
+  }
+  return std::string(std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>());
+}
+
+bool WriteFrqFile(const std::filesystem::path& path,
+                  const std::string_view data) {
+  // Unique among threads and processes writing the same file at once.
+  std::size_t thread = std::hash<std::thread::id>()(std::this_thread::get_id());
+  auto time = std::chrono::steady_clock::now().time_since_epoch().count();
+  std::string suffix =
+      "." + std::to_string(thread) + "." + std::to_string(time);
+  std::filesystem::path temp_path = path;
+  temp_path += suffix + ".tmp";
+  {
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    if (!file.write(data.data(), data.size()) || !file.flush()) {
+      file.close();
+      std::error_code error;
+      std::filesystem::remove(temp_path, error);
+      return false;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(temp_path, path, error);
+  if (error) {
+    std::filesystem::remove(temp_path, error);
+    return false;
+  }
+  return true;
+}
+
 }  // namespace worldline
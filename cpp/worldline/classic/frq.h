@@ -1,7 +1,9 @@
 #ifndef WORLDLINE_CLASSIC_FRQ_H_
 #define WORLDLINE_CLASSIC_FRQ_H_
 
+#include <filesystem>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace worldline {
@@ -17,6 +19,18 @@ FrqData LoadFrq(const std::string_view data);
 
 std::string DumpFrq(const FrqData& frq_data);
 
+// Path of the frq file UTAU tools look for next to a wav, <name>_wav.frq.
+std::string FrqPath(const std::string& wav_path);
+
+// Contents of the frq file at path, or empty if it cannot be read.
+std::string ReadFrqFile(const std::filesystem::path& path);
+
+// Writes data to path through a temporary file renamed over it, so that
+// readers never see a partial file. Returns false if it could not be
+// written.
+bool WriteFrqFile(const std::filesystem::path& path,
+                  const std::string_view data);
+
 }  // namespace worldline
 
 #endif  // WORLDLINE_CLASSIC_FRQ_H_
@@ -0,0 +1,45 @@
+#include "worldline/classic/frq.h"
+
+#include <filesystem>
+#include <iterator>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace worldline {
+namespace {
+
+TEST(FrqTest, PathIsNextToWav) {
+  EXPECT_EQ(FrqPath("voice/ka.wav"), "voice/ka_wav.frq");
+  EXPECT_EQ(FrqPath("voice"), "");
+}
+
+TEST(FrqTest, WritesWholeFile) {
+  FrqData frq{256, 220, {220, 221, 0}, {0.1, 0.2, 0}};
+  std::filesystem::path dir = std::filesystem::path(testing::TempDir()) /
+                              "frq_test_writes_whole_file";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir);
+  std::filesystem::path path = dir / "ka_wav.frq";
+  ASSERT_TRUE(WriteFrqFile(path, DumpFrq(frq)));
+  ASSERT_TRUE(WriteFrqFile(path, DumpFrq(frq)));
+
+  std::ifstream file(path, std::ios::binary);
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  FrqData loaded = LoadFrq(buffer.str());
+  EXPECT_EQ(loaded.hop_size, 256);
+  EXPECT_EQ(loaded.avg_frq, 220);
+  EXPECT_EQ(loaded.f0, frq.f0);
+  EXPECT_EQ(loaded.amp, frq.amp);
+  // Only the renamed file is left behind.
+  EXPECT_EQ(std::distance(std::filesystem::directory_iterator(dir),
+                          std::filesystem::directory_iterator()),
+            1);
+  std::filesystem::remove_all(dir);
+}
+
+}  // namespace
+}  // namespace worldline
@@ -2,24 +2,22 @@
 
 #include <algorithm>
 #include <cmath>
-#include <fstream>
+#include <filesystem>
 #include <iostream>
-#include <iterator>
 #include <memory>
 #include <optional>
-#include <sstream>
+#include <string_view>
 #include <vector>
 
-#include "audioio.h"
 #include "classic_args.h"
 #include "timing.h"
 #include "world/constantnumbers.h"
+#include "worldline/classic/frq.h"
 #include "worldline/common/vec_utils.h"
-#include "worldline/f0/f0_estimator.h"
-#include "worldline/f0/frq_estimator.h"
-#include "worldline/f0/pyin_estimator.h"
+#include "worldline/common/wav_reader.h"
 #include "worldline/model/effects.h"
 #include "worldline/model/model.h"
+#include "worldline/model/sample_store.h"
 #include "worldline/synth_request.h"
 
 namespace worldline {
@@ -27,67 +25,69 @@ namespace worldline {
 const double frame_ms = 10;
 const int padding = 2;
 
-Resampler::Resampler(SynthRequest request) : request_(request) {
-  std::vector<double> samples;
-  samples.reserve(request.sample_length);
-  std::copy(request.sample, request.sample + request.sample_length,
-            std::back_inserter(samples));
+Resampler::Resampler(SynthRequest request)
+    : Resampler(request, RequestSamples(request)) {}
 
-  std::unique_ptr<F0Estimator> f0_estimator = nullptr;
+Resampler::Resampler(SynthRequest request,
+                     std::shared_ptr<const std::vector<double>> samples)
+    : request_(request) {
+  QualityTier quality = static_cast<QualityTier>(request.quality);
+  std::string_view frq_data;
+  std::string written_frq;
   if (request.frq_length > 0) {
-    std::string_view frq_data(request.frq, request.frq_length);
-    f0_estimator = std::make_unique<FrqEstimator>(frq_data);
-  } else {
-    f0_estimator = std::make_unique<PyinEstimator>();
+    frq_data = std::string_view(request.frq, request.frq_length);
+  } else if (request.frq_write_path != nullptr &&
+             quality == QualityTier::kFinal) {
+    written_frq =
+        WriteBackFrq(*samples, request.sample_fs, request.sample_tone,
+                     std::filesystem::u8path(request.frq_write_path));
+    frq_data = written_frq;
   }
-
   model_ = std::make_unique<Model>(std::move(samples), request.sample_fs,
-                                   frame_ms, std::move(f0_estimator));
+                                   frame_ms,
+                                   MakeF0Estimator(frq_data, quality,
+                                                   request.sample_tone));
+  model_->set_quality(quality);
 }
 
-static std::string ReadFrqFile(const std::string& wav_path) {
-  int last_dot_index = wav_path.find_last_of('.');
-  if (last_dot_index <= 0) {
+static std::string ReadSampleFrq(const std::string& wav_path) {
+  std::string frq_path = FrqPath(wav_path);
+  if (frq_path.empty()) {
     return "";
   }
-  std::string frq_path = wav_path.substr(0, last_dot_index) + "_" +
-                         wav_path.substr(last_dot_index + 1) + ".frq";
-  std::ifstream frq_stream(frq_path.c_str(), std::ios::binary);
-  if (!frq_stream.good() || !frq_stream.is_open()) {
-    std::cout << "frq file not found" << std::endl;
-    return "";
-  }
-  std::cout << "frq file found" << std::endl;
-  std::stringstream sstream;
-  std::copy(std::istreambuf_iterator<char>(frq_stream),
-            std::istreambuf_iterator<char>(),
-            std::ostreambuf_iterator<char>(sstream));
-  frq_stream.close();
-  return sstream.str();
+  std::string frq_data = ReadFrqFile(frq_path);
+  std::cout << (frq_data.empty() ? "frq file not found" : "frq file found")
+            << std::endl;
+  return frq_data;
 }
 
-Resampler::Resampler(std::vector<std::string> args)
-    : request_(ParseClassicArgs(args)) {
-  std::vector<double> samples(GetAudioLength(args[0].c_str()), 0);
-  int fs;
-  int nbit;
-  wavread(args[0].c_str(), &fs, &nbit, samples.data());
-  std::string frq_data = ReadFrqFile(args[0]);
-  std::unique_ptr<F0Estimator> f0_estimator;
-  if (frq_data.empty()) {
-    f0_estimator = std::make_unique<PyinEstimator>();
-  } else {
-    f0_estimator = std::make_unique<FrqEstimator>(frq_data);
+Resampler::Resampler(SynthRequest request, std::unique_ptr<Model> model)
+    : request_(request), model_(std::move(model)) {}
+
+std::unique_ptr<Resampler> Resampler::FromArgs(
+    const std::vector<std::string>& args, bool write_frq) {
+  std::vector<double> samples;
+  int fs = 44100;
+  if (args.empty() || !ReadWav(args[0], &samples, &fs)) {
+    std::cout << "cannot read " << (args.empty() ? "" : args[0])
+              << std::endl;
+    return nullptr;
+  }
+  SynthRequest request = ParseClassicArgs(args);
+  std::string frq_data = ReadSampleFrq(args[0]);
+  if (frq_data.empty() && write_frq && !FrqPath(args[0]).empty()) {
+    frq_data = WriteBackFrq(samples, fs, request.sample_tone, FrqPath(args[0]));
   }
-  model_ = std::make_unique<Model>(std::move(samples), fs, frame_ms,
-                                   std::move(f0_estimator));
+  auto model = std::make_unique<Model>(
+      std::move(samples), fs, frame_ms,
+      MakeF0Estimator(frq_data, QualityTier::kFinal, request.sample_tone));
+  return std::unique_ptr<Resampler>(new Resampler(request, std::move(model)));
 }
 
 std::vector<double> Resampler::Resample() {
+  // Peak of the whole file, even though only the input region is analyzed.
   double src_max = vec_maxabs(model_->samples());
 
-  model_->BuildF0();
-
   auto mapping = GetTimeMapping(*model_, request_);
 
   // Trim model to input region.
@@ -100,6 +100,7 @@ std::vector<double> Resampler::Resample() {
   double left_trimmed = start_frame * frame_ms;
   double left_extra = start_ms - left_trimmed;
 
+  model_->BuildF0(start_frame, length_frame);
   model_->Trim(start_frame, length_frame);
   ShiftTimeMapping(mapping, -left_trimmed);
 
@@ -113,15 +114,15 @@ std::vector<double> Resampler::Resample() {
 
   ApplyPitch();
 
-  std::vector<std::vector<double>> tension;
+  std::vector<double> tension;
   std::vector<double> breathiness;
   std::vector<double> voicing;
   ApplyEffects(&tension, &breathiness, &voicing);
 
-  model_->Synth(tension, breathiness, voicing);
+  model_->Synth(tension, model_->f0(), breathiness, voicing);
 
   // Trims left and right extra.
-  std::vector<double> samples = std::move(model_->samples());
+  std::vector<double> samples = std::move(model_->mutable_samples());
   int left_extra_samples = model_->MsToSamples(left_extra);
   int length_samples = model_->MsToSamples(request_.required_length);
   samples.erase(samples.begin(), samples.begin() + left_extra_samples);
@@ -135,7 +136,7 @@ std::vector<double> Resampler::Resample() {
   return samples;
 }
 
-void Resampler::ApplyEffects(std::vector<std::vector<double>>* tension,
+void Resampler::ApplyEffects(std::vector<double>* tension,
                              std::vector<double>* breathiness,
                              std::vector<double>* voicing) {
   if (request_.flag_g != 0) {
@@ -144,11 +145,7 @@ void Resampler::ApplyEffects(std::vector<std::vector<double>>* tension,
 
   model_->SynthParams(tension, breathiness, voicing);
 
-  for (int i = 0; i < model_->f0().size(); ++i) {
-    tension->at(i) =
-        GetTensionCoefficients(model_->f0()[i], model_->fs(), request_.flag_Mt,
-                               model_->sp()[i].size());
-  }
+  std::fill(tension->begin(), tension->end(), request_.flag_Mt);
 
   double breathiness_value =
       1.0 + (request_.flag_Mb < 0 ? request_.flag_Mb * 0.01
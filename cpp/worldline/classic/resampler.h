@@ -13,12 +13,21 @@ namespace worldline {
 class Resampler {
  public:
   Resampler(SynthRequest request);
-  Resampler(std::vector<std::string> args);
+  // Borrows samples, e.g. shared by a cache, in place of request.sample.
+  Resampler(SynthRequest request,
+            std::shared_ptr<const std::vector<double>> samples);
+  // Resampler of a classic resampler call. With write_frq, f0 of a sample
+  // without a frq file is written to one. Returns nullptr if the input wav
+  // cannot be read.
+  static std::unique_ptr<Resampler> FromArgs(
+      const std::vector<std::string>& args, bool write_frq = false);
 
   std::vector<double> Resample();
 
  private:
-  void ApplyEffects(std::vector<std::vector<double>>* tension,
+  Resampler(SynthRequest request, std::unique_ptr<Model> model);
+
+  void ApplyEffects(std::vector<double>* tension,
                     std::vector<double>* breathiness,
                     std::vector<double>* voicing);
   void ApplyPitch();
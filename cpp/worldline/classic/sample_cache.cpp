@@ -0,0 +1,84 @@
+#include "sample_cache.h"
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "worldline/classic/frq.h"
+#include "worldline/common/wav_reader.h"
+
+namespace worldline {
+
+// Modification time of path, or the minimum if it does not exist.
+static std::filesystem::file_time_type WriteTime(
+    const std::filesystem::path& path) {
+  std::error_code error;
+  auto time = std::filesystem::last_write_time(path, error);
+  return error ? std::filesystem::file_time_type::min() : time;
+}
+
+SampleCache::SampleCache(std::size_t budget_bytes)
+    : budget_bytes_(budget_bytes) {}
+
+std::shared_ptr<const LoadedSample> SampleCache::Load(
+    const std::string& wav_path) {
+  std::error_code error;
+  auto wav_time = std::filesystem::last_write_time(wav_path, error);
+  if (error) {
+    return nullptr;
+  }
+  std::string frq_path = FrqPath(wav_path);
+  auto frq_time = frq_path.empty() ? std::filesystem::file_time_type::min()
+                                   : WriteTime(frq_path);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(wav_path);
+    if (it != index_.end() && it->second->wav_time == wav_time &&
+        it->second->frq_time == frq_time) {
+      lru_.splice(lru_.begin(), lru_, it->second);
+      return it->second->sample;
+    }
+  }
+
+  // Read outside of the lock, so that other samples load meanwhile.
+  auto sample = std::make_shared<LoadedSample>();
+  if (!ReadWav(wav_path, &sample->samples, &sample->fs) ||
+      sample->samples.empty()) {
+    return nullptr;
+  }
+  if (!frq_path.empty()) {
+    sample->frq = ReadFrqFile(frq_path);
+  }
+  std::size_t bytes =
+      sample->samples.size() * sizeof(double) + sample->frq.size();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(wav_path);
+  if (it != index_.end()) {
+    bytes_ -= it->second->bytes;
+    lru_.erase(it->second);
+    index_.erase(it);
+  }
+  if (bytes <= budget_bytes_) {
+    lru_.push_front(Entry{wav_path, wav_time, frq_time, sample, bytes});
+    index_[wav_path] = lru_.begin();
+    bytes_ += bytes;
+    EvictLocked();
+  }
+  return sample;
+}
+
+void SampleCache::EvictLocked() {
+  while (bytes_ > budget_bytes_ && !lru_.empty()) {
+    const Entry& entry = lru_.back();
+    bytes_ -= entry.bytes;
+    index_.erase(entry.path);
+    lru_.pop_back();
+  }
+}
+
+}  // namespace worldline
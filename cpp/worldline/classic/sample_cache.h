@@ -0,0 +1,58 @@
+#ifndef WORLDLINE_CLASSIC_SAMPLE_CACHE_H_
+#define WORLDLINE_CLASSIC_SAMPLE_CACHE_H_
+
+#include <cstddef>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace worldline {
+
+// A wav file decoded to samples, with the frq file next to it.
+struct LoadedSample {
+  std::vector<double> samples;
+  int fs;
+  // Empty if the sample has no frq file.
+  std::string frq;
+};
+
+// LRU cache of decoded samples for processes that render many requests,
+// bounded by a memory budget. Analysis results are cached separately by
+// AnalysisCache, keyed by the content of the samples. Thread safe.
+class SampleCache {
+ public:
+  static constexpr std::size_t kDefaultBudgetBytes = 128 << 20;
+
+  explicit SampleCache(std::size_t budget_bytes = kDefaultBudgetBytes);
+
+  // Returns the sample at wav_path, read again if the wav or its frq file
+  // changed on disk since it was cached. Returns nullptr if it cannot be
+  // read.
+  std::shared_ptr<const LoadedSample> Load(const std::string& wav_path);
+
+ private:
+  struct Entry {
+    std::string path;
+    std::filesystem::file_time_type wav_time;
+    std::filesystem::file_time_type frq_time;
+    std::shared_ptr<const LoadedSample> sample;
+    std::size_t bytes;
+  };
+
+  void EvictLocked();
+
+  std::mutex mutex_;
+  std::size_t budget_bytes_;
+  std::size_t bytes_ = 0;
+  // Most recently used entries first.
+  std::list<Entry> lru_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+};
+
+}  // namespace worldline
+
+#endif  // WORLDLINE_CLASSIC_SAMPLE_CACHE_H_
@@ -0,0 +1,601 @@
+#include "server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "worldline/classic/classic_args.h"
+#include "worldline/classic/frq.h"
+#include "worldline/classic/resampler.h"
+#include "worldline/common/wav_writer.h"
+#include "worldline/model/feature_store.h"
+#include "worldline/synth_request.h"
+
+namespace worldline {
+
+// Bounds of binary requests, beyond which the stream is taken as corrupt.
+constexpr std::uint32_t kMaxArgs = 64;
+constexpr std::uint32_t kMaxArgBytes = 1 << 20;
+
+static bool ReadUint32(std::istream& in, std::uint32_t* value) {
+  unsigned char bytes[4];
+  if (!in.read(reinterpret_cast<char*>(bytes), 4)) {
+    return false;
+  }
+  *value = bytes[0] | bytes[1] << 8 | bytes[2] << 16 |
+           static_cast<std::uint32_t>(bytes[3]) << 24;
+  return true;
+}
+
+static void WriteUint32(std::ostream& out, std::uint32_t value) {
+  char bytes[4] = {static_cast<char>(value), static_cast<char>(value >> 8),
+                   static_cast<char>(value >> 16),
+                   static_cast<char>(value >> 24)};
+  out.write(bytes, 4);
+}
+
+static void SkipSpaces(std::string_view text, std::size_t* pos) {
+  while (*pos < text.size() &&
+         (text[*pos] == ' ' || text[*pos] == '\t' || text[*pos] == '\r')) {
+    ++*pos;
+  }
+}
+
+static void AppendUtf8(std::uint32_t code, std::string* out) {
+  if (code < 0x80) {
+    out->push_back(static_cast<char>(code));
+  } else if (code < 0x800) {
+    out->push_back(static_cast<char>(0xc0 | code >> 6));
+    out->push_back(static_cast<char>(0x80 | (code & 0x3f)));
+  } else if (code < 0x10000) {
+    out->push_back(static_cast<char>(0xe0 | code >> 12));
+    out->push_back(static_cast<char>(0x80 | (code >> 6 & 0x3f)));
+    out->push_back(static_cast<char>(0x80 | (code & 0x3f)));
+  } else {
+    out->push_back(static_cast<char>(0xf0 | code >> 18));
+    out->push_back(static_cast<char>(0x80 | (code >> 12 & 0x3f)));
+    out->push_back(static_cast<char>(0x80 | (code >> 6 & 0x3f)));
+    out->push_back(static_cast<char>(0x80 | (code & 0x3f)));
+  }
+}
+
+static bool ParseHex4(std::string_view text, std::size_t pos,
+                      std::uint32_t* code) {
+  if (pos + 4 > text.size()) {
+    return false;
+  }
+  *code = 0;
+  for (std::size_t i = pos; i < pos + 4; ++i) {
+    char c = text[i];
+    int digit = c >= '0' && c <= '9'   ? c - '0'
+                : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                                       : -1;
+    if (digit < 0) {
+      return false;
+    }
+    *code = *code << 4 | digit;
+  }
+  return true;
+}
+
+// Parses the JSON string starting at *pos, leaving *pos after it.
+static bool ParseJsonString(std::string_view text, std::size_t* pos,
+                            std::string* out) {
+  if (*pos >= text.size() || text[*pos] != '"') {
+    return false;
+  }
+  out->clear();
+  for (std::size_t i = *pos + 1; i < text.size(); ++i) {
+    char c = text[i];
+    if (c == '"') {
+      *pos = i + 1;
+      return true;
+    }
+    if (c != '\\') {
+      out->push_back(c);
+      continue;
+    }
+    if (++i >= text.size()) {
+      return false;
+    }
+    switch (text[i]) {
+      case '"':
+      case '\\':
+      case '/':
+        out->push_back(text[i]);
+        break;
+      case 'b':
+        out->push_back('\b');
+        break;
+      case 'f':
+        out->push_back('\f');
+        break;
+      case 'n':
+        out->push_back('\n');
+        break;
+      case 'r':
+        out->push_back('\r');
+        break;
+      case 't':
+        out->push_back('\t');
+        break;
+      case 'u': {
+        std::uint32_t code;
+        if (!ParseHex4(text, i + 1, &code)) {
+          return false;
+        }
+        i += 4;
+        std::uint32_t low;
+        if (code >= 0xd800 && code < 0xdc00 && i + 2 < text.size() &&
+            text[i + 1] == '\\' && text[i + 2] == 'u' &&
+            ParseHex4(text, i + 3, &low) && low >= 0xdc00 && low < 0xe000) {
+          code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+          i += 6;
+        }
+        AppendUtf8(code, out);
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+  return false;
+}
+
+static bool ParseJsonArgs(std::string_view line,
+                          std::vector<std::string>* args) {
+  std::size_t pos = 0;
+  SkipSpaces(line, &pos);
+  if (pos >= line.size() || line[pos++] != '[') {
+    return false;
+  }
+  SkipSpaces(line, &pos);
+  if (pos < line.size() && line[pos] == ']') {
+    pos++;
+  } else {
+    while (true) {
+      std::string arg;
+      if (!ParseJsonString(line, &pos, &arg)) {
+        return false;
+      }
+      args->push_back(std::move(arg));
+      SkipSpaces(line, &pos);
+      if (pos >= line.size()) {
+        return false;
+      }
+      char c = line[pos++];
+      if (c == ']') {
+        break;
+      }
+      if (c != ',') {
+        return false;
+      }
+      SkipSpaces(line, &pos);
+    }
+  }
+  SkipSpaces(line, &pos);
+  return pos == line.size();
+}
+
+static std::string EscapeJson(const std::string& text) {
+  std::string escaped;
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      escaped.push_back('\\');
+      escaped.push_back(c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      static constexpr char kHex[] = "0123456789abcdef";
+      escaped += "\\u00";
+      escaped.push_back(kHex[c >> 4]);
+      escaped.push_back(kHex[c & 0xf]);
+    } else {
+      escaped.push_back(c);
+    }
+  }
+  return escaped;
+}
+
+ReadResult ReadClassicRequest(std::istream& in, bool json,
+                              std::vector<std::string>* args) {
+  args->clear();
+  if (json) {
+    std::string line;
+    do {
+      if (!std::getline(in, line)) {
+        return ReadResult::kEnd;
+      }
+    } while (line.find_first_not_of(" \t\r") == std::string::npos);
+    return ParseJsonArgs(line, args) ? ReadResult::kOk
+                                     : ReadResult::kMalformed;
+  }
+  if (in.peek() == std::char_traits<char>::eof()) {
+    return ReadResult::kEnd;
+  }
+  std::uint32_t argc;
+  if (!ReadUint32(in, &argc) || argc > kMaxArgs) {
+    return ReadResult::kMalformed;
+  }
+  for (std::uint32_t i = 0; i < argc; ++i) {
+    std::uint32_t length;
+    if (!ReadUint32(in, &length) || length > kMaxArgBytes) {
+      return ReadResult::kMalformed;
+    }
+    std::string arg(length, '\0');
+    if (!in.read(arg.data(), length)) {
+      return ReadResult::kMalformed;
+    }
+    args->push_back(std::move(arg));
+  }
+  return ReadResult::kOk;
+}
+
+void WriteClassicReply(std::ostream& out, bool json,
+                       const std::string& error) {
+  if (json) {
+    if (error.empty()) {
+      out << "{\"ok\": true}\n";
+    } else {
+      out << "{\"ok\": false, \"error\": \"" << EscapeJson(error) << "\"}\n";
+    }
+    return;
+  }
+  std::string reply = error.empty() ? "ok" : "error: " + error;
+  WriteUint32(out, reply.size());
+  out.write(reply.data(), reply.size());
+}
+
+// Mounts the feature store of each voicebank once, as main does for its
+// only request.
+static void MountFeatureStore(const std::string& wav_path) {
+  static std::mutex mutex;
+  static std::set<std::filesystem::path>* mounted =
+      new std::set<std::filesystem::path>();
+  std::filesystem::path dir = std::filesystem::path(wav_path).parent_path();
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!mounted->insert(dir).second) {
+    return;
+  }
+  if (auto store =
+          FeatureStore::Open((dir / kFeatureStoreFileName).string())) {
+    FeatureStore::Mount(std::move(store));
+  }
+}
+
+// Rejects input regions the sample does not cover, as OpenUtau does before
+// rendering, rather than analyzing past its ends.
+static std::string ValidateRegion(const SynthRequest& request) {
+  constexpr double frame_ms = 10;
+  double total_ms = 1000.0 * request.sample_length / request.sample_fs;
+  double in_length_ms = request.cut_off < 0
+                            ? -request.cut_off
+                            : total_ms - request.offset - request.cut_off;
+  int in_start_frame = static_cast<int>(request.offset / frame_ms);
+  int in_length_frame =
+      static_cast<int>(std::ceil(request.offset + in_length_ms) / frame_ms) -
+      in_start_frame;
+  if ((in_start_frame + in_length_frame) * frame_ms * request.sample_fs >
+      request.sample_length * 1000.0) {
+    return "cutoff exceeds the duration of the sample";
+  }
+  if (in_length_frame <= 0) {
+    return "cutoff is before offset";
+  }
+  return "";
+}
+
+std::string RenderClassic(const std::vector<std::string>& args,
+                          SampleCache* cache, bool write_frq) {
+  if (args.size() < 2) {
+    return "expected at least the input and output paths";
+  }
+  std::shared_ptr<const LoadedSample> sample = cache->Load(args[0]);
+  if (sample == nullptr) {
+    return "cannot read " + args[0];
+  }
+  MountFeatureStore(args[0]);
+
+  SynthRequest request = ParseClassicArgs(args);
+  std::unique_ptr<std::int32_t[]> pitch_bend(request.pitch_bend);
+  request.sample_fs = sample->fs;
+  request.sample_length = sample->samples.size();
+  request.frq_length = sample->frq.size();
+  request.frq = const_cast<char*>(sample->frq.data());
+  std::string frq_path = FrqPath(args[0]);
+  if (sample->frq.empty() && write_frq && !frq_path.empty()) {
+    request.frq_write_path = frq_path.data();
+  }
+  std::string error = ValidateRegion(request);
+  if (!error.empty()) {
+    return error;
+  }
+  // The model reads the cached samples in place.
+  std::vector<double> y =
+      Resampler(request, std::shared_ptr<const std::vector<double>>(
+                             sample, &sample->samples))
+          .Resample();
+  if (!WriteWav(args[1], y, 44100)) {
+    return "cannot write " + args[1];
+  }
+  return "";
+}
+
+void Serve(std::istream& in, std::ostream& out, const ServerOptions& options,
+           SampleCache* cache) {
+  int jobs = std::clamp(options.jobs, 1,
+                        std::max(1, static_cast<int>(
+                                        std::thread::hardware_concurrency())));
+  // Replies not written yet, bounding the requests read ahead.
+  const std::size_t max_pending = 2 * jobs;
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::deque<std::function<void()>> tasks;
+  std::deque<std::future<std::string>> replies;
+  bool reading = true;
+
+  std::vector<std::thread> workers;
+  for (int i = 0; i < jobs; ++i) {
+    workers.emplace_back([&]() {
+      while (true) {
+        std::function<void()> task;
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          changed.wait(lock, [&]() { return !tasks.empty() || !reading; });
+          if (tasks.empty()) {
+            return;
+          }
+          task = std::move(tasks.front());
+          tasks.pop_front();
+        }
+        task();
+      }
+    });
+  }
+  std::thread writer([&]() {
+    while (true) {
+      std::future<std::string> reply;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return !replies.empty() || !reading; });
+        if (replies.empty()) {
+          return;
+        }
+        reply = std::move(replies.front());
+        replies.pop_front();
+      }
+      changed.notify_all();
+      WriteClassicReply(out, options.json, reply.get());
+      out.flush();
+    }
+  });
+
+  while (true) {
+    std::vector<std::string> args;
+    ReadResult result = ReadClassicRequest(in, options.json, &args);
+    if (result == ReadResult::kEnd) {
+      break;
+    }
+    auto promise = std::make_shared<std::promise<std::string>>();
+    std::future<std::string> reply = promise->get_future();
+    std::function<void()> task;
+    if (result == ReadResult::kMalformed) {
+      promise->set_value("malformed request");
+    } else {
+      task = [promise, args = std::move(args), cache, &options]() {
+        // A failed render must still reply, or the writer waits forever.
+        std::string reply;
+        try {
+          reply = RenderClassic(args, cache, options.write_frq);
+        } catch (const std::exception& e) {
+          reply = std::string("render failed: ") + e.what();
+        } catch (...) {
+          reply = "render failed";
+        }
+        promise->set_value(reply);
+      };
+    }
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      changed.wait(lock, [&]() { return replies.size() < max_pending; });
+      replies.push_back(std::move(reply));
+      if (task) {
+        tasks.push_back(std::move(task));
+      }
+    }
+    changed.notify_all();
+    // The rest of a binary stream cannot be framed after a bad request.
+    if (result == ReadResult::kMalformed && !options.json) {
+      break;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    reading = false;
+  }
+  changed.notify_all();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  writer.join();
+}
+
+namespace {
+
+#if defined(_WIN32)
+int ReadFd(int fd, char* data, int size) { return _read(fd, data, size); }
+int WriteFd(int fd, const char* data, int size) {
+  return _write(fd, data, size);
+}
+#else
+int ReadFd(int fd, char* data, int size) { return read(fd, data, size); }
+int WriteFd(int fd, const char* data, int size) {
+  return write(fd, data, size);
+}
+#endif
+
+// Buffered stream over a file descriptor.
+class FdBuf : public std::streambuf {
+ public:
+  explicit FdBuf(int fd) : fd_(fd) {
+    setg(in_, in_, in_);
+    setp(out_, out_ + sizeof(out_));
+  }
+
+ protected:
+  int_type underflow() override {
+    int n;
+    do {
+      n = ReadFd(fd_, in_, sizeof(in_));
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+      return traits_type::eof();
+    }
+    setg(in_, in_, in_ + n);
+    return traits_type::to_int_type(in_[0]);
+  }
+
+  int_type overflow(int_type c) override {
+    if (sync() != 0) {
+      return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+  int sync() override {
+    const char* data = pbase();
+    while (data < pptr()) {
+      int n = WriteFd(fd_, data, pptr() - data);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        return -1;
+      }
+      data += n;
+    }
+    setp(out_, out_ + sizeof(out_));
+    return 0;
+  }
+
+ private:
+  int fd_;
+  char in_[4096];
+  char out_[4096];
+};
+
+}  // namespace
+
+bool ServeStdio(const ServerOptions& options, SampleCache* cache) {
+  // Replies get a duplicate of stdout, and fd 1 itself is pointed at stderr,
+  // so that whatever is printed to stdout, also by C code such as WORLD, ends
+  // up logged instead of corrupting the replies.
+  std::cout.flush();
+  std::fflush(stdout);
+#if defined(_WIN32)
+  _setmode(0, _O_BINARY);
+  _setmode(1, _O_BINARY);
+  int reply_fd = _dup(1);
+  if (reply_fd < 0 || _dup2(2, 1) != 0) {
+    return false;
+  }
+#else
+  int reply_fd = dup(1);
+  if (reply_fd < 0 || dup2(2, 1) < 0) {
+    return false;
+  }
+#endif
+  FdBuf in_buf(0);
+  FdBuf out_buf(reply_fd);
+  std::istream in(&in_buf);
+  std::ostream out(&out_buf);
+  Serve(in, out, options, cache);
+  out.flush();
+  return true;
+}
+
+#if !defined(_WIN32)
+
+bool ServeUnixSocket(const std::string& path, const ServerOptions& options,
+                     SampleCache* cache) {
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    return false;
+  }
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+  int server = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (server < 0) {
+    return false;
+  }
+  // Replaces the socket of a previous server.
+  unlink(path.c_str());
+  if (bind(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) !=
+          0 ||
+      listen(server, 16) != 0) {
+    close(server);
+    return false;
+  }
+  while (true) {
+    int client = accept(server, nullptr, nullptr);
+    if (client < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      close(server);
+      return false;
+    }
+    // Connections are served concurrently, sharing cache.
+    std::thread([client, options, cache]() {
+      FdBuf buf(client);
+      std::istream in(&buf);
+      std::ostream out(&buf);
+      Serve(in, out, options, cache);
+      close(client);
+    }).detach();
+  }
+}
+
+#else
+
+bool ServeUnixSocket(const std::string& path, const ServerOptions& options,
+                     SampleCache* cache) {
+  return false;
+}
+
+#endif
+
+}  // namespace worldline
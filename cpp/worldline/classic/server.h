@@ -0,0 +1,62 @@
+#ifndef WORLDLINE_CLASSIC_SERVER_H_
+#define WORLDLINE_CLASSIC_SERVER_H_
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "worldline/classic/sample_cache.h"
+
+namespace worldline {
+
+// Long-running classic resampler. Each request is the argument vector of
+// one resampler call, starting with the input and output wav paths. The
+// reply tells whether the output was written.
+//
+// Binary framing, all integers little endian uint32:
+//   request: <argc> then <length> <bytes> for each argument
+//   reply:   <length> <bytes>, "ok" or "error: <message>"
+// JSON framing, one line each:
+//   request: ["in.wav", "out.wav", "C4", "100", "g-5", ...]
+//   reply:   {"ok": true} or {"ok": false, "error": "<message>"}
+struct ServerOptions {
+  // Requests rendered at once, at most one per core. Each render also runs
+  // its analysis on the shared thread pool, so a few jobs keep the machine
+  // busy.
+  int jobs = 1;
+  bool json = false;
+  // Writes f0 of samples without a frq file to one.
+  bool write_frq = false;
+};
+
+enum class ReadResult { kOk, kEnd, kMalformed };
+
+ReadResult ReadClassicRequest(std::istream& in, bool json,
+                              std::vector<std::string>* args);
+void WriteClassicReply(std::ostream& out, bool json, const std::string& error);
+
+// Renders args as the classic resampler does and writes the result to
+// args[1]. Returns an error message, or an empty string on success.
+std::string RenderClassic(const std::vector<std::string>& args,
+                          SampleCache* cache, bool write_frq);
+
+// Serves requests read from in until its end. Up to options.jobs requests
+// render at once, and replies are written to out in request order.
+void Serve(std::istream& in, std::ostream& out, const ServerOptions& options,
+           SampleCache* cache);
+
+// Serves requests from stdin, replying on stdout, until stdin ends. Anything
+// else printed to stdout goes to stderr meanwhile. Returns false if stdout
+// cannot be redirected.
+bool ServeStdio(const ServerOptions& options, SampleCache* cache);
+
+// Serves each connection to a Unix socket at path as Serve does, until the
+// process ends. Returns false if the socket cannot be listened on, or on
+// platforms without Unix sockets.
+bool ServeUnixSocket(const std::string& path, const ServerOptions& options,
+                     SampleCache* cache);
+
+}  // namespace worldline
+
+#endif  // WORLDLINE_CLASSIC_SERVER_H_
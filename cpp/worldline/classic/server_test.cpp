@@ -0,0 +1,125 @@
+#include "worldline/classic/server.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "worldline/classic/sample_cache.h"
+#include "worldline/common/wav_writer.h"
+
+namespace worldline {
+namespace {
+
+void AppendUint32(std::uint32_t value, std::string* out) {
+  for (int i = 0; i < 4; ++i) {
+    out->push_back(static_cast<char>(value >> (8 * i)));
+  }
+}
+
+std::string Frame(const std::vector<std::string>& args) {
+  std::string frame;
+  AppendUint32(args.size(), &frame);
+  for (const std::string& arg : args) {
+    AppendUint32(arg.size(), &frame);
+    frame += arg;
+  }
+  return frame;
+}
+
+TEST(ServerTest, ReadsBinaryRequests) {
+  std::istringstream in(Frame({"in.wav", "out.wav", "C4"}) +
+                        Frame({"a b.wav", ""}));
+  std::vector<std::string> args;
+  ASSERT_EQ(ReadClassicRequest(in, false, &args), ReadResult::kOk);
+  EXPECT_EQ(args, (std::vector<std::string>{"in.wav", "out.wav", "C4"}));
+  ASSERT_EQ(ReadClassicRequest(in, false, &args), ReadResult::kOk);
+  EXPECT_EQ(args, (std::vector<std::string>{"a b.wav", ""}));
+  EXPECT_EQ(ReadClassicRequest(in, false, &args), ReadResult::kEnd);
+
+  std::istringstream truncated(Frame({"in.wav", "out.wav"}).substr(0, 9));
+  EXPECT_EQ(ReadClassicRequest(truncated, false, &args),
+            ReadResult::kMalformed);
+}
+
+TEST(ServerTest, ReadsJsonRequests) {
+  std::istringstream in(
+      "[\"C:\\\\voice\\\\ka.wav\", \"out.wav\", \"g-5\\u00e9\"]\r\n"
+      "\n"
+      "[\"in.wav\", 100]\n"
+      "[]\n");
+  std::vector<std::string> args;
+  ASSERT_EQ(ReadClassicRequest(in, true, &args), ReadResult::kOk);
+  EXPECT_EQ(args, (std::vector<std::string>{"C:\\voice\\ka.wav", "out.wav",
+                                            "g-5\xc3\xa9"}));
+  EXPECT_EQ(ReadClassicRequest(in, true, &args), ReadResult::kMalformed);
+  ASSERT_EQ(ReadClassicRequest(in, true, &args), ReadResult::kOk);
+  EXPECT_TRUE(args.empty());
+  EXPECT_EQ(ReadClassicRequest(in, true, &args), ReadResult::kEnd);
+}
+
+TEST(ServerTest, RepliesInRequestOrder) {
+  std::string requests;
+  for (int i = 0; i < 20; ++i) {
+    requests += "[\"missing" + std::to_string(i) + ".wav\", \"out.wav\"]\n";
+  }
+  requests += "[\"too few\"]\n";
+  std::istringstream in(requests);
+  std::ostringstream out;
+  SampleCache cache;
+  ServerOptions options;
+  options.jobs = 4;
+  options.json = true;
+  Serve(in, out, options, &cache);
+
+  std::istringstream replies(out.str());
+  std::string reply;
+  for (int i = 0; i < 20; ++i) {
+    ASSERT_TRUE(std::getline(replies, reply));
+    EXPECT_EQ(reply, "{\"ok\": false, \"error\": \"cannot read missing" +
+                         std::to_string(i) + ".wav\"}");
+  }
+  ASSERT_TRUE(std::getline(replies, reply));
+  EXPECT_EQ(reply,
+            "{\"ok\": false, \"error\": \"expected at least the input and "
+            "output paths\"}");
+  EXPECT_FALSE(std::getline(replies, reply));
+}
+
+TEST(ServerTest, RejectsRegionsOutsideOfTheSample) {
+  std::filesystem::path dir = testing::TempDir();
+  std::string in_path = (dir / "server_region.wav").string();
+  std::string out_path = (dir / "server_region_out.wav").string();
+  // 100 ms.
+  ASSERT_TRUE(WriteWav(in_path, std::vector<double>(4410, 0.1), 44100));
+  SampleCache cache;
+  // offset 0, 500 ms from it.
+  EXPECT_EQ(RenderClassic({in_path, out_path, "C4", "100", "", "0", "500",
+                           "0", "-500"},
+                          &cache, false),
+            "cutoff exceeds the duration of the sample");
+  // offset 50 ms, cutoff 60 ms from the end.
+  EXPECT_EQ(RenderClassic({in_path, out_path, "C4", "100", "", "50", "500",
+                           "0", "60"},
+                          &cache, false),
+            "cutoff is before offset");
+  EXPECT_FALSE(std::filesystem::exists(out_path));
+  std::filesystem::remove(in_path);
+}
+
+TEST(ServerTest, WritesBinaryReplies) {
+  std::ostringstream out;
+  WriteClassicReply(out, false, "");
+  WriteClassicReply(out, false, "bad");
+  std::string expected;
+  AppendUint32(2, &expected);
+  expected += "ok";
+  AppendUint32(10, &expected);
+  expected += "error: bad";
+  EXPECT_EQ(out.str(), expected);
+}
+
+}  // namespace
+}  // namespace worldline
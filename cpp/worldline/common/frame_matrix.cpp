@@ -0,0 +1,254 @@
+#include "frame_matrix.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace worldline {
+
+constexpr int kAlignedDoubles = FrameMatrix::kAlignment / sizeof(double);
+
+// Large buffers recently released by matrices. Matrices of similar sizes
+// are created and dropped one note after another; returning their memory to
+// the system would make every new matrix fault its pages in again.
+class BufferPool {
+ public:
+  static BufferPool& Global() {
+    static BufferPool* pool = new BufferPool();
+    return *pool;
+  }
+
+  // Returns a block of at least bytes and at most twice as large, or nullptr.
+  double* Take(std::size_t bytes, std::size_t* block_bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto best = blocks_.end();
+    for (auto it = blocks_.begin(); it != blocks_.end(); ++it) {
+      if (it->bytes >= bytes && it->bytes <= bytes * 2 &&
+          (best == blocks_.end() || it->bytes < best->bytes)) {
+        best = it;
+      }
+    }
+    if (best == blocks_.end()) {
+      return nullptr;
+    }
+    double* data = best->data;
+    *block_bytes = best->bytes;
+    total_bytes_ -= best->bytes;
+    blocks_.erase(best);
+    return data;
+  }
+
+  // Returns false if the pool is full.
+  bool Give(double* data, std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (total_bytes_ + bytes > kMaxBytes) {
+      return false;
+    }
+    blocks_.push_back(Block{data, bytes});
+    total_bytes_ += bytes;
+    return true;
+  }
+
+  std::size_t total_bytes() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return total_bytes_;
+  }
+
+  static constexpr std::size_t kMinBytes = 128 << 10;
+  static constexpr std::size_t kMaxBytes = 32 << 20;
+
+ private:
+  struct Block {
+    double* data;
+    std::size_t bytes;
+  };
+
+  std::mutex mutex_;
+  std::vector<Block> blocks_;
+  std::size_t total_bytes_ = 0;
+};
+
+// Allocates at least rows rows, and sets capacity to the rows actually
+// allocated.
+static double* Allocate(int rows, int stride, int* capacity) {
+  std::size_t row_bytes = stride * sizeof(double);
+  std::size_t bytes = rows * row_bytes;
+  if (bytes >= BufferPool::kMinBytes) {
+    std::size_t block_bytes;
+    if (double* data = BufferPool::Global().Take(bytes, &block_bytes)) {
+      *capacity = block_bytes / row_bytes;
+      return data;
+    }
+  }
+  *capacity = rows;
+  return static_cast<double*>(
+      ::operator new(bytes, std::align_val_t(FrameMatrix::kAlignment)));
+}
+
+static void Free(double* buffer, int capacity, int stride) {
+  std::size_t bytes = static_cast<std::size_t>(capacity) * stride *
+                      sizeof(double);
+  if (buffer == nullptr ||
+      (bytes >= BufferPool::kMinBytes &&
+       BufferPool::Global().Give(buffer, bytes))) {
+    return;
+  }
+  ::operator delete(buffer, std::align_val_t(FrameMatrix::kAlignment));
+}
+
+std::size_t FrameMatrix::PooledBytes() {
+  return BufferPool::Global().total_bytes();
+}
+
+FrameMatrix::FrameMatrix(int rows, int width, double value)
+    : FrameMatrix(Uninitialized(rows, width)) {
+  std::fill(buffer_, buffer_ + rows_ * stride_, value);
+}
+
+FrameMatrix FrameMatrix::Uninitialized(int rows, int width) {
+  FrameMatrix matrix;
+  matrix.rows_ = rows;
+  matrix.width_ = width;
+  matrix.stride_ =
+      (width + kAlignedDoubles - 1) / kAlignedDoubles * kAlignedDoubles;
+  matrix.buffer_ = Allocate(rows, matrix.stride_, &matrix.capacity_);
+  matrix.data_ = matrix.buffer_;
+  return matrix;
+}
+
+FrameMatrix::FrameMatrix(const FrameMatrix& other)
+    : rows_(other.rows_), width_(other.width_), stride_(other.stride_) {
+  buffer_ = Allocate(rows_, stride_, &capacity_);
+  data_ = buffer_;
+  std::copy(other.data_, other.data_ + rows_ * stride_, data_);
+}
+
+FrameMatrix::FrameMatrix(FrameMatrix&& other) noexcept
+    : buffer_(other.buffer_),
+      data_(other.data_),
+      capacity_(other.capacity_),
+      rows_(other.rows_),
+      width_(other.width_),
+      stride_(other.stride_) {
+  other.buffer_ = nullptr;
+  other.data_ = nullptr;
+  other.capacity_ = 0;
+  other.rows_ = 0;
+}
+
+FrameMatrix& FrameMatrix::operator=(const FrameMatrix& other) {
+  if (this != &other) {
+    FrameMatrix copy(other);
+    *this = std::move(copy);
+  }
+  return *this;
+}
+
+FrameMatrix& FrameMatrix::operator=(FrameMatrix&& other) noexcept {
+  if (this != &other) {
+    Free(buffer_, capacity_, stride_);
+    buffer_ = other.buffer_;
+    data_ = other.data_;
+    capacity_ = other.capacity_;
+    rows_ = other.rows_;
+    width_ = other.width_;
+    stride_ = other.stride_;
+    other.buffer_ = nullptr;
+    other.data_ = nullptr;
+    other.capacity_ = 0;
+    other.rows_ = 0;
+  }
+  return *this;
+}
+
+FrameMatrix::~FrameMatrix() { Free(buffer_, capacity_, stride_); }
+
+std::vector<double*> FrameMatrix::RowPointers() {
+  std::vector<double*> result(rows_);
+  for (int i = 0; i < rows_; ++i) {
+    result[i] = (*this)[i];
+  }
+  return result;
+}
+
+std::vector<const double*> FrameMatrix::ConstRowPointers() const {
+  std::vector<const double*> result(rows_);
+  for (int i = 0; i < rows_; ++i) {
+    result[i] = (*this)[i];
+  }
+  return result;
+}
+
+void FrameMatrix::Trim(int start, int length) {
+  data_ += start * stride_;
+  rows_ = length;
+}
+
+void FrameMatrix::Resize(int rows, double value) {
+  Reserve(rows);
+  if (rows > rows_) {
+    std::fill(data_ + rows_ * stride_, data_ + rows * stride_, value);
+  }
+  rows_ = rows;
+}
+
+void FrameMatrix::Resize(int rows, const double* row) {
+  if (rows <= rows_) {
+    rows_ = rows;
+    return;
+  }
+  std::vector<double> fill(row, row + width_);
+  Reserve(rows);
+  fill.resize(stride_, 0);
+  for (int i = rows_; i < rows; ++i) {
+    std::copy(fill.begin(), fill.end(), (*this)[i]);
+  }
+  rows_ = rows;
+}
+
+void FrameMatrix::Pad(int before, int after) {
+  if (rows_ == 0 || (before == 0 && after == 0)) {
+    return;
+  }
+  int start = (data_ - buffer_) / stride_;
+  int rows = rows_ + before + after;
+  if (start >= before && start - before + rows <= capacity_) {
+    data_ -= before * stride_;
+  } else {
+    int capacity;
+    double* buffer = Allocate(rows, stride_, &capacity);
+    std::copy(data_, data_ + rows_ * stride_, buffer + before * stride_);
+    Free(buffer_, capacity_, stride_);
+    buffer_ = buffer;
+    data_ = buffer;
+    capacity_ = capacity;
+  }
+  const double* first = data_ + before * stride_;
+  for (int i = 0; i < before; ++i) {
+    std::copy(first, first + stride_, (*this)[i]);
+  }
+  const double* last = data_ + (before + rows_ - 1) * stride_;
+  for (int i = before + rows_; i < rows; ++i) {
+    std::copy(last, last + stride_, (*this)[i]);
+  }
+  rows_ = rows;
+}
+
+void FrameMatrix::Reserve(int rows) {
+  int start = buffer_ == nullptr ? 0 : (data_ - buffer_) / stride_;
+  if (start + rows <= capacity_) {
+    return;
+  }
+  int capacity;
+  double* buffer = Allocate(std::max(rows, rows_ * 2), stride_, &capacity);
+  std::copy(data_, data_ + rows_ * stride_, buffer);
+  Free(buffer_, capacity_, stride_);
+  buffer_ = buffer;
+  data_ = buffer;
+  capacity_ = capacity;
+}
+
+}  // namespace worldline
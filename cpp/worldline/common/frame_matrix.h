@@ -0,0 +1,67 @@
+#ifndef WORLDLINE_COMMON_FRAME_MATRIX_H_
+#define WORLDLINE_COMMON_FRAME_MATRIX_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace worldline {
+
+// Row-major matrix with one row per analysis frame, e.g. sp, ap or residual.
+// All rows live in a single 64-byte aligned buffer, and every row starts on
+// a 64-byte boundary. Trim only moves the view, not the data.
+class FrameMatrix {
+ public:
+  static constexpr std::size_t kAlignment = 64;
+
+  FrameMatrix() = default;
+  FrameMatrix(int rows, int width, double value = 0);
+  // Leaves the values undefined, for matrices about to be overwritten.
+  static FrameMatrix Uninitialized(int rows, int width);
+  FrameMatrix(const FrameMatrix& other);
+  FrameMatrix(FrameMatrix&& other) noexcept;
+  FrameMatrix& operator=(const FrameMatrix& other);
+  FrameMatrix& operator=(FrameMatrix&& other) noexcept;
+  ~FrameMatrix();
+
+  // Bytes of freed buffers kept process-wide for reuse by later matrices.
+  static std::size_t PooledBytes();
+
+  int rows() const { return rows_; }
+  int width() const { return width_; }
+  // Distance between rows in doubles.
+  int stride() const { return stride_; }
+  bool empty() const { return rows_ == 0; }
+
+  double* operator[](int row) { return data_ + row * stride_; }
+  const double* operator[](int row) const { return data_ + row * stride_; }
+
+  // Pointers to each row, for the double** arguments of WORLD.
+  std::vector<double*> RowPointers();
+  std::vector<const double*> ConstRowPointers() const;
+
+  // Keeps rows [start, start + length).
+  void Trim(int start, int length);
+  // Changes the number of rows. New rows are filled with value, or with a
+  // copy of row, which may be a row of this matrix.
+  void Resize(int rows, double value);
+  void Resize(int rows, const double* row);
+  // Adds before copies of the first row in front and after copies of the
+  // last row at the end. Rows are moved into the space freed by an earlier
+  // Trim when there is enough of it.
+  void Pad(int before, int after);
+
+ private:
+  void Reserve(int rows);
+
+  double* buffer_ = nullptr;
+  // First visible row within buffer_.
+  double* data_ = nullptr;
+  int capacity_ = 0;
+  int rows_ = 0;
+  int width_ = 0;
+  int stride_ = 0;
+};
+
+}  // namespace worldline
+
+#endif  // WORLDLINE_COMMON_FRAME_MATRIX_H_
@@ -0,0 +1,108 @@
+#include "worldline/common/frame_matrix.h"
+
+#include <cstdint>
+#include <utility>
+
+#include "gtest/gtest.h"
+
+namespace worldline {
+namespace {
+
+bool IsAligned(const double* p) {
+  return reinterpret_cast<std::uintptr_t>(p) % FrameMatrix::kAlignment == 0;
+}
+
+FrameMatrix Iota(int rows, int width) {
+  FrameMatrix matrix(rows, width);
+  for (int i = 0; i < rows; ++i) {
+    for (int j = 0; j < width; ++j) {
+      matrix[i][j] = i * 1000 + j;
+    }
+  }
+  return matrix;
+}
+
+TEST(FrameMatrixTest, RowsAreAligned) {
+  FrameMatrix matrix(5, 1025, 1);
+  EXPECT_EQ(matrix.rows(), 5);
+  EXPECT_EQ(matrix.width(), 1025);
+  EXPECT_GE(matrix.stride(), 1025);
+  std::vector<double*> rows = matrix.RowPointers();
+  ASSERT_EQ(rows.size(), 5);
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_TRUE(IsAligned(rows[i]));
+    EXPECT_EQ(rows[i], matrix[i]);
+    EXPECT_EQ(rows[i][1024], 1);
+  }
+}
+
+TEST(FrameMatrixTest, TrimKeepsDataInPlace) {
+  FrameMatrix matrix = Iota(10, 3);
+  const double* row3 = matrix[3];
+  matrix.Trim(3, 4);
+  EXPECT_EQ(matrix.rows(), 4);
+  EXPECT_EQ(matrix[0], row3);
+  EXPECT_EQ(matrix[3][2], 6002);
+
+  FrameMatrix copy = matrix;
+  EXPECT_EQ(copy.rows(), 4);
+  EXPECT_EQ(copy[0][1], 3001);
+  EXPECT_TRUE(IsAligned(copy[0]));
+}
+
+TEST(FrameMatrixTest, ResizeFillsNewRows) {
+  FrameMatrix matrix = Iota(2, 3);
+  matrix.Trim(1, 1);
+  matrix.Resize(4, -1.0);
+  EXPECT_EQ(matrix.rows(), 4);
+  EXPECT_EQ(matrix[0][2], 1002);
+  EXPECT_EQ(matrix[3][0], -1);
+
+  matrix.Resize(6, matrix[0]);
+  EXPECT_EQ(matrix[5][1], 1001);
+  EXPECT_TRUE(IsAligned(matrix[5]));
+
+  matrix.Resize(1, 0.0);
+  EXPECT_EQ(matrix.rows(), 1);
+  EXPECT_EQ(matrix[0][0], 1000);
+}
+
+TEST(FrameMatrixTest, PadRepeatsEdgeRows) {
+  FrameMatrix matrix = Iota(6, 3);
+  matrix.Trim(2, 3);
+  const double* row2 = matrix[0];
+  matrix.Pad(2, 1);
+  EXPECT_EQ(matrix.rows(), 6);
+  EXPECT_EQ(matrix[2], row2);
+  EXPECT_EQ(matrix[0][1], 2001);
+  EXPECT_EQ(matrix[1][2], 2002);
+  EXPECT_EQ(matrix[4][0], 4000);
+  EXPECT_EQ(matrix[5][0], 4000);
+
+  // Without room in front, rows move to a new buffer.
+  matrix.Pad(1, 0);
+  EXPECT_EQ(matrix.rows(), 7);
+  EXPECT_EQ(matrix[0][0], 2000);
+  EXPECT_EQ(matrix[6][2], 4002);
+  EXPECT_TRUE(IsAligned(matrix[0]));
+}
+
+TEST(FrameMatrixTest, MoveLeavesEmpty) {
+  FrameMatrix matrix = Iota(2, 3);
+  FrameMatrix moved = std::move(matrix);
+  EXPECT_EQ(moved.rows(), 2);
+  EXPECT_TRUE(matrix.empty());
+}
+
+TEST(FrameMatrixTest, PoolsFreedBuffers) {
+  std::size_t before = FrameMatrix::PooledBytes();
+  { FrameMatrix matrix(1024, 1025); }
+  std::size_t pooled = FrameMatrix::PooledBytes();
+  EXPECT_GE(pooled, before + 1024 * 1025 * sizeof(double));
+  // Taken back by a matrix of about the same size.
+  FrameMatrix matrix(1000, 1025);
+  EXPECT_LT(FrameMatrix::PooledBytes(), pooled);
+}
+
+}  // namespace
+}  // namespace worldline
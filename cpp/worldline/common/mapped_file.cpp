@@ -0,0 +1,112 @@
+#include "mapped_file.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace worldline {
+
+#if defined(_WIN32)
+
+std::unique_ptr<MappedFile> MappedFile::Open(const std::string& path) {
+  // Paths from the command line are in the ANSI code page, which is told
+  // apart from UTF-8 by failing to decode as UTF-8.
+  UINT code_page = CP_UTF8;
+  int wide_length = MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS,
+                                        path.c_str(), -1, nullptr, 0);
+  if (wide_length == 0) {
+    code_page = CP_ACP;
+    wide_length =
+        MultiByteToWideChar(CP_ACP, 0, path.c_str(), -1, nullptr, 0);
+  }
+  std::wstring wide_path(wide_length, L'\0');
+  MultiByteToWideChar(code_page, 0, path.c_str(), -1, wide_path.data(),
+                      wide_length);
+  HANDLE file = CreateFileW(wide_path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return nullptr;
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    return nullptr;
+  }
+  std::unique_ptr<MappedFile> mapped(new MappedFile());
+  mapped->file_ = file;
+  mapped->size_ = static_cast<std::size_t>(size.QuadPart);
+  if (mapped->size_ == 0) {
+    return mapped;
+  }
+  HANDLE mapping =
+      CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    return nullptr;
+  }
+  mapped->mapping_ = mapping;
+  mapped->data_ = static_cast<const char*>(
+      MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  if (mapped->data_ == nullptr) {
+    return nullptr;
+  }
+  return mapped;
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_ != nullptr) {
+    CloseHandle(mapping_);
+  }
+  if (file_ != nullptr) {
+    CloseHandle(file_);
+  }
+}
+
+#else
+
+std::unique_ptr<MappedFile> MappedFile::Open(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return nullptr;
+  }
+  std::unique_ptr<MappedFile> mapped(new MappedFile());
+  mapped->size_ = static_cast<std::size_t>(st.st_size);
+  if (mapped->size_ > 0) {
+    void* data = mmap(nullptr, mapped->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      return nullptr;
+    }
+    mapped->data_ = static_cast<const char*>(data);
+  }
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+  return mapped;
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+}
+
+#endif
+
+}  // namespace worldline
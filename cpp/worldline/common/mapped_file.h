@@ -0,0 +1,37 @@
+#ifndef WORLDLINE_COMMON_MAPPED_FILE_H_
+#define WORLDLINE_COMMON_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace worldline {
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+ public:
+  // Returns nullptr if the file cannot be opened or mapped. On Windows, path
+  // is UTF-8, or in the ANSI code page if it is not valid UTF-8.
+  static std::unique_ptr<MappedFile> Open(const std::string& path);
+
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* data() const { return data_; }
+  std::size_t size() const { return size_; }
+
+ private:
+  MappedFile() = default;
+
+  const char* data_ = nullptr;
+  std::size_t size_ = 0;
+#if defined(_WIN32)
+  void* file_ = nullptr;
+  void* mapping_ = nullptr;
+#endif
+};
+
+}  // namespace worldline
+
+#endif  // WORLDLINE_COMMON_MAPPED_FILE_H_
@@ -0,0 +1,161 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace worldline {
+
+constexpr int kMaxGlobalThreads = 16;
+
+// Pool and index of the worker running on this thread, if any.
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local int current_worker = -1;
+
+ThreadPool::ThreadPool(int threads) {
+  for (int i = 0; i < threads; ++i) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  for (int i = 0; i < threads; ++i) {
+    workers_.emplace_back(&ThreadPool::WorkerLoop, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+ThreadPool& ThreadPool::Global() {
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+  static ThreadPool* pool = new ThreadPool(0);
+#else
+  // The calling thread takes part in ParallelFor, so it is not counted.
+  static ThreadPool* pool = new ThreadPool(std::min<int>(
+      kMaxGlobalThreads,
+      std::max<int>(0, std::thread::hardware_concurrency() - 1)));
+#endif
+  return *pool;
+}
+
+void ThreadPool::ParallelFor(int n, const std::function<void(int)>& fn) {
+  if (queues_.empty() || n <= 1) {
+    for (int i = 0; i < n; ++i) {
+      fn(i);
+    }
+    return;
+  }
+  struct Batch {
+    std::atomic<int> remaining;
+    std::mutex mutex;
+    std::condition_variable done;
+  };
+  auto batch = std::make_shared<Batch>();
+  batch->remaining = n;
+  int self = current_pool == this ? current_worker : -1;
+  for (int i = 0; i < n; ++i) {
+    int queue = self >= 0 ? self : i % size();
+    Push(queue, [batch, &fn, i]() {
+      fn(i);
+      if (--batch->remaining == 0) {
+        std::lock_guard<std::mutex> lock(batch->mutex);
+        batch->done.notify_all();
+      }
+    });
+  }
+  while (batch->remaining > 0) {
+    if (!RunOne(self)) {
+      // Every task of the batch has been taken, wait for the last ones.
+      std::unique_lock<std::mutex> lock(batch->mutex);
+      batch->done.wait(lock, [&]() { return batch->remaining == 0; });
+    }
+  }
+}
+
+bool ThreadPool::Post(std::function<void()> task) {
+  if (queues_.empty()) {
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    background_.push_back(std::move(task));
+  }
+  wake_.notify_one();
+  return true;
+}
+
+void ThreadPool::Push(int queue, std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(queues_[queue]->mutex);
+    queues_[queue]->tasks.push_back(std::move(task));
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queued_++;
+  }
+  wake_.notify_one();
+}
+
+bool ThreadPool::RunOne(int self) {
+  std::function<void()> task;
+  if (self >= 0) {
+    Queue& own = *queues_[self];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+    }
+  }
+  for (int i = 1; !task && i <= size(); ++i) {
+    Queue& other = *queues_[(std::max(self, 0) + i) % size()];
+    std::lock_guard<std::mutex> lock(other.mutex);
+    if (!other.tasks.empty()) {
+      task = std::move(other.tasks.front());
+      other.tasks.pop_front();
+    }
+  }
+  if (!task) {
+    return false;
+  }
+  queued_--;
+  task();
+  return true;
+}
+
+void ThreadPool::WorkerLoop(int self) {
+  current_pool = this;
+  current_worker = self;
+  while (true) {
+    if (RunOne(self)) {
+      continue;
+    }
+    // Background tasks are only taken by idle workers, so that they never
+    // delay the ParallelFor they would otherwise be stolen by.
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [&]() {
+        return stop_ || queued_ > 0 || !background_.empty();
+      });
+      if (stop_) {
+        return;
+      }
+      // queued_ may have dropped back to 0 since the wait, when the task
+      // that woke this worker was taken by another thread.
+      if (queued_ == 0 && !background_.empty()) {
+        task = std::move(background_.front());
+        background_.pop_front();
+      }
+    }
+    if (task) {
+      task();
+    }
+  }
+}
+
+}  // namespace worldline
@@ -0,0 +1,62 @@
+#ifndef WORLDLINE_COMMON_THREAD_POOL_H_
+#define WORLDLINE_COMMON_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace worldline {
+
+// Fixed set of workers, each with its own task deque. A worker runs the
+// newest task of its own deque first and steals the oldest task of another
+// deque when its own is empty.
+class ThreadPool {
+ public:
+  // With 0 threads, all tasks run on the calling thread.
+  explicit ThreadPool(int threads);
+  ~ThreadPool();
+
+  // Shared by the library, sized to the machine. Has no workers in wasm
+  // builds without pthreads.
+  static ThreadPool& Global();
+
+  int size() const { return static_cast<int>(queues_.size()); }
+
+  // Calls fn(i) for every i in [0, n) and returns when all calls are done.
+  // The calling thread runs tasks too, so this may be nested in fn.
+  void ParallelFor(int n, const std::function<void(int)>& fn);
+  // Runs task on a worker once no other task is queued, and returns without
+  // waiting for it. Tasks still pending when the pool is destroyed are
+  // dropped. Returns false, without running task, if there are no workers.
+  bool Post(std::function<void()> task);
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void Push(int queue, std::function<void()> task);
+  // Runs one queued task, preferring the queue of worker self. Returns false
+  // if all queues are empty.
+  bool RunOne(int self);
+  void WorkerLoop(int self);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> workers_;
+  std::atomic<int> queued_{0};
+  std::mutex mutex_;
+  // Tasks of Post, guarded by mutex_.
+  std::deque<std::function<void()>> background_;
+  std::condition_variable wake_;
+  bool stop_ = false;
+};
+
+}  // namespace worldline
+
+#endif  // WORLDLINE_COMMON_THREAD_POOL_H_
@@ -0,0 +1,83 @@
+#include "worldline/common/thread_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace worldline {
+namespace {
+
+TEST(ThreadPoolTest, RunsEveryIndexOnce) {
+  ThreadPool pool(4);
+  std::vector<int> counts(1000, 0);
+  pool.ParallelFor(counts.size(), [&](int i) { counts[i]++; });
+  for (int count : counts) {
+    EXPECT_EQ(count, 1);
+  }
+}
+
+TEST(ThreadPoolTest, RunsInlineWithoutWorkers) {
+  ThreadPool pool(0);
+  std::vector<int> order;
+  pool.ParallelFor(3, [&](int i) { order.push_back(i); });
+  EXPECT_EQ(order, std::vector<int>({0, 1, 2}));
+}
+
+TEST(ThreadPoolTest, SupportsNestedLoops) {
+  ThreadPool pool(2);
+  std::atomic<int> total(0);
+  pool.ParallelFor(8, [&](int i) {
+    pool.ParallelFor(8, [&](int j) { total += i * 8 + j; });
+  });
+  EXPECT_EQ(total, 63 * 64 / 2);
+}
+
+TEST(ThreadPoolTest, PostsTasksToWorkers) {
+  ThreadPool pool(2);
+  std::promise<int> done;
+  EXPECT_TRUE(pool.Post([&]() { done.set_value(42); }));
+  std::future<int> result = done.get_future();
+  ASSERT_EQ(result.wait_for(std::chrono::seconds(10)),
+            std::future_status::ready);
+  EXPECT_EQ(result.get(), 42);
+}
+
+TEST(ThreadPoolTest, RunsPostedTasksAlongsideLoops) {
+  ThreadPool pool(4);
+  constexpr int kPosts = 200;
+  std::atomic<int> posted(0);
+  std::promise<void> done;
+  std::atomic<int> total(0);
+  std::thread poster([&]() {
+    for (int i = 0; i < kPosts; ++i) {
+      EXPECT_TRUE(pool.Post([&]() {
+        if (++posted == kPosts) {
+          done.set_value();
+        }
+      }));
+    }
+  });
+  for (int round = 0; round < 200; ++round) {
+    pool.ParallelFor(16, [&](int i) { total += i; });
+  }
+  poster.join();
+  EXPECT_EQ(total, 200 * (15 * 16 / 2));
+  std::future<void> result = done.get_future();
+  ASSERT_EQ(result.wait_for(std::chrono::seconds(10)),
+            std::future_status::ready);
+  EXPECT_EQ(posted, kPosts);
+}
+
+TEST(ThreadPoolTest, DoesNotPostWithoutWorkers) {
+  ThreadPool pool(0);
+  bool ran = false;
+  EXPECT_FALSE(pool.Post([&]() { ran = true; }));
+  EXPECT_FALSE(ran);
+}
+
+}  // namespace
+}  // namespace worldline
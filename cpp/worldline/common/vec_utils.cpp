@@ -8,37 +8,100 @@
 
 #include "npy.hpp"
 
-namespace worldline {
-
-std::vector<std::vector<double>> vec2d(int width, int length, double value) {
-  return std::vector<std::vector<double>>(length,
-                                          std::vector<double>(width, value));
-}
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
 
-std::vector<double*> vec2d_wrapper(std::vector<std::vector<double>>& vec) {
-  std::vector<double*> result;
-  result.reserve(vec.size());
-  std::transform(vec.begin(), vec.end(), std::back_inserter(result),
-                 [](std::vector<double>& v) { return v.data(); });
-  return result;
-}
+namespace worldline {
 
-std::vector<double> vec2d_to_1d(const std::vector<std::vector<double>>& vec) {
+std::vector<double> vec2d_to_1d(const FrameMatrix& vec) {
   std::vector<double> result;
-  result.reserve(vec.size() * vec[0].size());
-  for (const std::vector<double>& v : vec) {
-    std::copy(v.begin(), v.end(), std::back_inserter(result));
+  result.reserve(vec.rows() * vec.width());
+  for (int i = 0; i < vec.rows(); ++i) {
+    std::copy(vec[i], vec[i] + vec.width(), std::back_inserter(result));
   }
   return result;
 }
 
-std::vector<double> vec_lerp(const std::vector<double>& vec0,
-                             const std::vector<double>& vec1, double t) {
-  std::vector<double> result(vec0.size());
-  for (int i = 0; i < vec0.size(); ++i) {
+void vec_lerp(const double* vec0, const double* vec1, double t, int length,
+              double* result) {
+  int i = 0;
+#if defined(__AVX2__)
+  __m256d w0 = _mm256_set1_pd(1.0 - t);
+  __m256d w1 = _mm256_set1_pd(t);
+  for (; i + 4 <= length; i += 4) {
+    __m256d v0 = _mm256_loadu_pd(vec0 + i);
+    __m256d v1 = _mm256_loadu_pd(vec1 + i);
+    _mm256_storeu_pd(result + i, _mm256_add_pd(_mm256_mul_pd(v0, w0),
+                                               _mm256_mul_pd(v1, w1)));
+  }
+#elif defined(__SSE2__) || defined(_M_X64)
+  __m128d w0 = _mm_set1_pd(1.0 - t);
+  __m128d w1 = _mm_set1_pd(t);
+  for (; i + 2 <= length; i += 2) {
+    __m128d v0 = _mm_loadu_pd(vec0 + i);
+    __m128d v1 = _mm_loadu_pd(vec1 + i);
+    _mm_storeu_pd(result + i,
+                  _mm_add_pd(_mm_mul_pd(v0, w0), _mm_mul_pd(v1, w1)));
+  }
+#elif defined(__wasm_simd128__)
+  v128_t w0 = wasm_f64x2_splat(1.0 - t);
+  v128_t w1 = wasm_f64x2_splat(t);
+  for (; i + 2 <= length; i += 2) {
+    v128_t v0 = wasm_v128_load(vec0 + i);
+    v128_t v1 = wasm_v128_load(vec1 + i);
+    wasm_v128_store(result + i, wasm_f64x2_add(wasm_f64x2_mul(v0, w0),
+                                               wasm_f64x2_mul(v1, w1)));
+  }
+#endif
+  for (; i < length; ++i) {
     result[i] = vec0[i] * (1.0 - t) + vec1[i] * t;
   }
-  return result;
+}
+
+void vec_gather_lerp(const double* vec, const int* index0, const int* index1,
+                     const double* t, int length, double* result) {
+  int i = 0;
+#if defined(__AVX2__)
+  __m256d one = _mm256_set1_pd(1.0);
+  for (; i + 4 <= length; i += 4) {
+    __m128i i0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(index0 + i));
+    __m128i i1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(index1 + i));
+    __m256d v0 = _mm256_i32gather_pd(vec, i0, 8);
+    __m256d v1 = _mm256_i32gather_pd(vec, i1, 8);
+    __m256d w1 = _mm256_loadu_pd(t + i);
+    __m256d w0 = _mm256_sub_pd(one, w1);
+    _mm256_storeu_pd(result + i, _mm256_add_pd(_mm256_mul_pd(v0, w0),
+                                               _mm256_mul_pd(v1, w1)));
+  }
+#elif defined(__SSE2__) || defined(_M_X64)
+  __m128d one = _mm_set1_pd(1.0);
+  for (; i + 2 <= length; i += 2) {
+    __m128d v0 = _mm_set_pd(vec[index0[i + 1]], vec[index0[i]]);
+    __m128d v1 = _mm_set_pd(vec[index1[i + 1]], vec[index1[i]]);
+    __m128d w1 = _mm_loadu_pd(t + i);
+    __m128d w0 = _mm_sub_pd(one, w1);
+    _mm_storeu_pd(result + i,
+                  _mm_add_pd(_mm_mul_pd(v0, w0), _mm_mul_pd(v1, w1)));
+  }
+#elif defined(__wasm_simd128__)
+  v128_t one = wasm_f64x2_splat(1.0);
+  for (; i + 2 <= length; i += 2) {
+    v128_t v0 = wasm_f64x2_make(vec[index0[i]], vec[index0[i + 1]]);
+    v128_t v1 = wasm_f64x2_make(vec[index1[i]], vec[index1[i + 1]]);
+    v128_t w1 = wasm_v128_load(t + i);
+    v128_t w0 = wasm_f64x2_sub(one, w1);
+    wasm_v128_store(result + i, wasm_f64x2_add(wasm_f64x2_mul(v0, w0),
+                                               wasm_f64x2_mul(v1, w1)));
+  }
+#endif
+  for (; i < length; ++i) {
+    result[i] = vec[index0[i]] * (1 - t[i]) + vec[index1[i]] * t[i];
+  }
 }
 
 void vec_print(const std::vector<double>& vec) {
@@ -49,7 +112,7 @@ void vec_print(const std::vector<double>& vec) {
   std::cout << "]" << std::endl;
 }
 
-double vec_maxabs(const std::vector<double>& vec) {
+double vec_maxabs(absl::Span<const double> vec) {
   auto result = std::minmax_element(vec.begin(), vec.end());
   return std::max(std::abs(*result.first), std::abs(*result.second));
 }
@@ -60,12 +123,11 @@ void save_vec(const std::string& filename, const std::vector<double>& vec) {
   npy::SaveArrayAsNumpy<double>(filename, false, 1, shape, vec);
 }
 
-void save_vec2d(const std::string& filename,
-                const std::vector<std::vector<double>>& vec) {
+void save_vec2d(const std::string& filename, const FrameMatrix& vec) {
   std::vector<double> temp = vec2d_to_1d(vec);
   unsigned long shape[2];
-  shape[0] = vec.size();
-  shape[1] = vec[0].size();
+  shape[0] = vec.rows();
+  shape[1] = vec.width();
   npy::SaveArrayAsNumpy<double>(filename, false, 2, shape, temp);
 }
 
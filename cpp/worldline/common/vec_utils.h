@@ -4,25 +4,30 @@
 #include <string>
 #include <vector>
 
-namespace worldline {
+#include "absl/types/span.h"
+#include "worldline/common/frame_matrix.h"
 
-std::vector<std::vector<double>> vec2d(int width, int length, double value);
+namespace worldline {
 
-std::vector<double*> vec2d_wrapper(std::vector<std::vector<double>>& vec);
+std::vector<double> vec2d_to_1d(const FrameMatrix& vec);
 
-std::vector<double> vec2d_to_1d(const std::vector<std::vector<double>>& vec);
+// result = vec0 * (1 - t) + vec1 * t, vectorized with AVX2, SSE2 or wasm
+// SIMD128 when the target supports it. result may alias vec0 or vec1.
+void vec_lerp(const double* vec0, const double* vec1, double t, int length,
+              double* result);
 
-std::vector<double> vec_lerp(const std::vector<double>& vec0,
-                             const std::vector<double>& vec1, double t);
+// result[i] = vec[index0[i]] * (1 - t[i]) + vec[index1[i]] * t[i], with the
+// same vectorization as vec_lerp. result must not alias vec.
+void vec_gather_lerp(const double* vec, const int* index0, const int* index1,
+                     const double* t, int length, double* result);
 
 void vec_print(const std::vector<double>& vec);
 
-double vec_maxabs(const std::vector<double>& vec);
+double vec_maxabs(absl::Span<const double> vec);
 
 void save_vec(const std::string& filename, const std::vector<double>& vec);
 
-void save_vec2d(const std::string& filename,
-                const std::vector<std::vector<double>>& vec);
+void save_vec2d(const std::string& filename, const FrameMatrix& vec);
 
 }  // namespace worldline
 
@@ -0,0 +1,294 @@
+#include "wav_reader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
+namespace worldline {
+
+constexpr std::uint16_t kFormatPcm = 1;
+constexpr std::uint16_t kFormatFloat = 3;
+constexpr std::uint16_t kFormatExtensible = 0xfffe;
+// Frames converted at once when picking a channel, so that the interleaved
+// buffer stays in cache.
+constexpr std::size_t kChannelBlock = 4096;
+
+// Wav files are little endian, as are all supported targets.
+static std::uint16_t LoadU16(const char* p) {
+  std::uint16_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static std::uint32_t LoadU32(const char* p) {
+  std::uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+// out[i] = in[i] / 32768 for count 16-bit samples.
+static void ConvertInt16(const char* in, std::size_t count, double* out) {
+  const double scale = 1.0 / 32768;
+  std::size_t i = 0;
+#if defined(__AVX2__)
+  __m256d s = _mm256_set1_pd(scale);
+  for (; i + 4 <= count; i += 4) {
+    __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + 2 * i));
+    __m256d d = _mm256_cvtepi32_pd(_mm_cvtepi16_epi32(x));
+    _mm256_storeu_pd(out + i, _mm256_mul_pd(d, s));
+  }
+#elif defined(__SSE2__) || defined(_M_X64)
+  __m128d s = _mm_set1_pd(scale);
+  for (; i + 8 <= count; i += 8) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i));
+    // Sign-extends by moving each sample to the high half and shifting back.
+    __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+    __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+    _mm_storeu_pd(out + i, _mm_mul_pd(_mm_cvtepi32_pd(lo), s));
+    _mm_storeu_pd(out + i + 2,
+                  _mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(lo, 0xee)), s));
+    _mm_storeu_pd(out + i + 4, _mm_mul_pd(_mm_cvtepi32_pd(hi), s));
+    _mm_storeu_pd(out + i + 6,
+                  _mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(hi, 0xee)), s));
+  }
+#elif defined(__wasm_simd128__)
+  v128_t s = wasm_f64x2_splat(scale);
+  for (; i + 8 <= count; i += 8) {
+    v128_t x = wasm_v128_load(in + 2 * i);
+    v128_t lo = wasm_i32x4_extend_low_i16x8(x);
+    v128_t hi = wasm_i32x4_extend_high_i16x8(x);
+    v128_t lo_high = wasm_i32x4_shuffle(lo, lo, 2, 3, 0, 1);
+    v128_t hi_high = wasm_i32x4_shuffle(hi, hi, 2, 3, 0, 1);
+    wasm_v128_store(out + i,
+                    wasm_f64x2_mul(wasm_f64x2_convert_low_i32x4(lo), s));
+    wasm_v128_store(out + i + 2,
+                    wasm_f64x2_mul(wasm_f64x2_convert_low_i32x4(lo_high), s));
+    wasm_v128_store(out + i + 4,
+                    wasm_f64x2_mul(wasm_f64x2_convert_low_i32x4(hi), s));
+    wasm_v128_store(out + i + 6,
+                    wasm_f64x2_mul(wasm_f64x2_convert_low_i32x4(hi_high), s));
+  }
+#endif
+  for (; i < count; ++i) {
+    out[i] = static_cast<std::int16_t>(LoadU16(in + 2 * i)) * scale;
+  }
+}
+
+// out[i] = in[i] / 2^31 for count 32-bit samples.
+static void ConvertInt32(const char* in, std::size_t count, double* out) {
+  const double scale = 1.0 / 2147483648.0;
+  std::size_t i = 0;
+#if defined(__AVX2__)
+  __m256d s = _mm256_set1_pd(scale);
+  for (; i + 4 <= count; i += 4) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 4 * i));
+    _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_cvtepi32_pd(x), s));
+  }
+#elif defined(__SSE2__) || defined(_M_X64)
+  __m128d s = _mm_set1_pd(scale);
+  for (; i + 4 <= count; i += 4) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 4 * i));
+    _mm_storeu_pd(out + i, _mm_mul_pd(_mm_cvtepi32_pd(x), s));
+    _mm_storeu_pd(out + i + 2,
+                  _mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(x, 0xee)), s));
+  }
+#elif defined(__wasm_simd128__)
+  v128_t s = wasm_f64x2_splat(scale);
+  for (; i + 4 <= count; i += 4) {
+    v128_t x = wasm_v128_load(in + 4 * i);
+    v128_t high = wasm_i32x4_shuffle(x, x, 2, 3, 0, 1);
+    wasm_v128_store(out + i,
+                    wasm_f64x2_mul(wasm_f64x2_convert_low_i32x4(x), s));
+    wasm_v128_store(out + i + 2,
+                    wasm_f64x2_mul(wasm_f64x2_convert_low_i32x4(high), s));
+  }
+#endif
+  for (; i < count; ++i) {
+    out[i] = static_cast<std::int32_t>(LoadU32(in + 4 * i)) * scale;
+  }
+}
+
+// out[i] = in[i] for count 32-bit float samples.
+static void ConvertFloat32(const char* in, std::size_t count, double* out) {
+  std::size_t i = 0;
+#if defined(__AVX2__)
+  for (; i + 4 <= count; i += 4) {
+    _mm256_storeu_pd(out + i,
+                     _mm256_cvtps_pd(_mm_loadu_ps(
+                         reinterpret_cast<const float*>(in + 4 * i))));
+  }
+#elif defined(__SSE2__) || defined(_M_X64)
+  for (; i + 4 <= count; i += 4) {
+    __m128 x = _mm_loadu_ps(reinterpret_cast<const float*>(in + 4 * i));
+    _mm_storeu_pd(out + i, _mm_cvtps_pd(x));
+    _mm_storeu_pd(out + i + 2, _mm_cvtps_pd(_mm_movehl_ps(x, x)));
+  }
+#elif defined(__wasm_simd128__)
+  for (; i + 4 <= count; i += 4) {
+    v128_t x = wasm_v128_load(in + 4 * i);
+    v128_t high = wasm_i32x4_shuffle(x, x, 2, 3, 0, 1);
+    wasm_v128_store(out + i, wasm_f64x2_promote_low_f32x4(x));
+    wasm_v128_store(out + i + 2, wasm_f64x2_promote_low_f32x4(high));
+  }
+#endif
+  for (; i < count; ++i) {
+    float value;
+    std::memcpy(&value, in + 4 * i, sizeof(value));
+    out[i] = value;
+  }
+}
+
+static void ConvertInt24(const char* in, std::size_t count, double* out) {
+  const double scale = 1.0 / 8388608;
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(in);
+  for (std::size_t i = 0; i < count; ++i, p += 3) {
+    // Sign-extends from the top byte of a 32-bit value.
+    std::int32_t value = static_cast<std::int32_t>(
+                             static_cast<std::uint32_t>(p[0]) << 8 |
+                             static_cast<std::uint32_t>(p[1]) << 16 |
+                             static_cast<std::uint32_t>(p[2]) << 24) >>
+                         8;
+    out[i] = value * scale;
+  }
+}
+
+static void ConvertUint8(const char* in, std::size_t count, double* out) {
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(in);
+  for (std::size_t i = 0; i < count; ++i) {
+    out[i] = (p[i] - 128) / 128.0;
+  }
+}
+
+static void Convert(int bits, bool is_float, const char* in,
+                    std::size_t count, double* out) {
+  if (is_float) {
+    ConvertFloat32(in, count, out);
+    return;
+  }
+  switch (bits) {
+    case 8:
+      ConvertUint8(in, count, out);
+      break;
+    case 16:
+      ConvertInt16(in, count, out);
+      break;
+    case 24:
+      ConvertInt24(in, count, out);
+      break;
+    case 32:
+      ConvertInt32(in, count, out);
+      break;
+  }
+}
+
+std::unique_ptr<WavReader> WavReader::Open(const std::string& path) {
+  std::unique_ptr<MappedFile> file = MappedFile::Open(path);
+  if (file == nullptr) {
+    return nullptr;
+  }
+  std::unique_ptr<WavReader> reader(new WavReader());
+  if (!reader->Parse(file->data(), file->size())) {
+    return nullptr;
+  }
+  reader->file_ = std::move(file);
+  return reader;
+}
+
+std::unique_ptr<WavReader> WavReader::FromBuffer(const char* data,
+                                                 std::size_t size) {
+  std::unique_ptr<WavReader> reader(new WavReader());
+  if (!reader->Parse(data, size)) {
+    return nullptr;
+  }
+  return reader;
+}
+
+bool WavReader::Parse(const char* data, std::size_t size) {
+  if (size < 12 || std::memcmp(data, "RIFF", 4) != 0 ||
+      std::memcmp(data + 8, "WAVE", 4) != 0) {
+    return false;
+  }
+  bool has_format = false;
+  std::size_t pos = 12;
+  while (pos + 8 <= size) {
+    const char* id = data + pos;
+    std::size_t chunk_size = LoadU32(data + pos + 4);
+    pos += 8;
+    std::size_t available = std::min(chunk_size, size - pos);
+    if (std::memcmp(id, "fmt ", 4) == 0) {
+      if (available < 16) {
+        return false;
+      }
+      std::uint16_t format = LoadU16(data + pos);
+      channels_ = LoadU16(data + pos + 2);
+      fs_ = static_cast<int>(LoadU32(data + pos + 4));
+      bits_ = LoadU16(data + pos + 14);
+      if (format == kFormatExtensible && available >= 26) {
+        // The sub format GUID starts with the plain format tag.
+        format = LoadU16(data + pos + 24);
+      }
+      is_float_ = format == kFormatFloat;
+      bool supported =
+          (format == kFormatPcm &&
+           (bits_ == 8 || bits_ == 16 || bits_ == 24 || bits_ == 32)) ||
+          (is_float_ && bits_ == 32);
+      if (!supported || channels_ <= 0 || fs_ <= 0) {
+        return false;
+      }
+      has_format = true;
+    } else if (std::memcmp(id, "data", 4) == 0 && has_format) {
+      // Streaming writers leave the size unset, as 0 or 0xffffffff, and the
+      // file bounds it.
+      if (chunk_size == 0 || chunk_size == 0xffffffff) {
+        available = size - pos;
+      }
+      data_ = data + pos;
+      length_ = available / (channels_ * (bits_ / 8));
+      return true;
+    }
+    // Chunks are padded to an even size.
+    pos += chunk_size + (chunk_size & 1);
+  }
+  return false;
+}
+
+void WavReader::Read(double* samples) const {
+  if (channels_ == 1) {
+    Convert(bits_, is_float_, data_, length_, samples);
+    return;
+  }
+  std::size_t frame_bytes = channels_ * (bits_ / 8);
+  std::vector<double> block(kChannelBlock * channels_);
+  for (std::size_t begin = 0; begin < length_; begin += kChannelBlock) {
+    std::size_t count = std::min(kChannelBlock, length_ - begin);
+    Convert(bits_, is_float_, data_ + begin * frame_bytes, count * channels_,
+            block.data());
+    for (std::size_t i = 0; i < count; ++i) {
+      samples[begin + i] = block[i * channels_];
+    }
+  }
+}
+
+bool ReadWav(const std::string& path, std::vector<double>* samples, int* fs) {
+  std::unique_ptr<WavReader> reader = WavReader::Open(path);
+  if (reader == nullptr) {
+    return false;
+  }
+  samples->resize(reader->length());
+  reader->Read(samples->data());
+  *fs = reader->fs();
+  return true;
+}
+
+}  // namespace worldline
@@ -0,0 +1,58 @@
+#ifndef WORLDLINE_COMMON_WAV_READER_H_
+#define WORLDLINE_COMMON_WAV_READER_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "worldline/common/mapped_file.h"
+
+namespace worldline {
+
+// Decoder of RIFF WAVE files, read through a memory mapping. Supports 8, 16,
+// 24 and 32-bit integer PCM and 32-bit float, plain or in
+// WAVE_FORMAT_EXTENSIBLE, with any number of channels. Samples decode to
+// doubles in [-1, 1] as WORLD's wavread scales them. Only the first channel
+// is kept rather than a downmix, matching ToMono(1, 0) that OpenUtau reads
+// samples with elsewhere, so that both paths analyze the same signal.
+// Conversion is vectorized with AVX2, SSE2 or wasm SIMD128 when the target
+// supports it.
+class WavReader {
+ public:
+  // Returns nullptr if the file cannot be mapped or is not a supported wav.
+  static std::unique_ptr<WavReader> Open(const std::string& path);
+  // Reads a whole wav file held in memory, which must outlive the reader.
+  static std::unique_ptr<WavReader> FromBuffer(const char* data,
+                                               std::size_t size);
+
+  int fs() const { return fs_; }
+  int channels() const { return channels_; }
+  int bits() const { return bits_; }
+  bool is_float() const { return is_float_; }
+  // Samples per channel.
+  std::size_t length() const { return length_; }
+
+  // Decodes all samples of the first channel into samples[0, length()).
+  void Read(double* samples) const;
+
+ private:
+  WavReader() = default;
+  bool Parse(const char* data, std::size_t size);
+
+  std::unique_ptr<MappedFile> file_;
+  const char* data_ = nullptr;
+  int fs_ = 0;
+  int channels_ = 0;
+  int bits_ = 0;
+  bool is_float_ = false;
+  std::size_t length_ = 0;
+};
+
+// Reads the first channel of the wav file at path into samples. Returns false,
+// leaving the arguments untouched, if it cannot be read.
+bool ReadWav(const std::string& path, std::vector<double>* samples, int* fs);
+
+}  // namespace worldline
+
+#endif  // WORLDLINE_COMMON_WAV_READER_H_
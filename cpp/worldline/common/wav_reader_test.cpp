@@ -0,0 +1,188 @@
+#include "worldline/common/wav_reader.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace worldline {
+namespace {
+
+void Append(std::uint32_t value, int bytes, std::string* out) {
+  for (int i = 0; i < bytes; ++i) {
+    out->push_back(static_cast<char>(value >> (8 * i)));
+  }
+}
+
+// Wav file of values in [-1, 1), interleaved by channel.
+std::string MakeWav(const std::vector<double>& values, int channels, int bits,
+                    bool is_float, bool extensible = false) {
+  std::string data;
+  for (double value : values) {
+    if (is_float) {
+      float f = static_cast<float>(value);
+      std::uint32_t raw;
+      std::memcpy(&raw, &f, sizeof(raw));
+      Append(raw, 4, &data);
+    } else if (bits == 8) {
+      Append(static_cast<std::uint32_t>(std::lround(value * 128) + 128), 1,
+             &data);
+    } else {
+      Append(static_cast<std::uint32_t>(
+                 std::llround(value * std::pow(2.0, bits - 1))),
+             bits / 8, &data);
+    }
+  }
+  std::uint16_t format = is_float ? 3 : 1;
+  std::string fmt;
+  Append(extensible ? 0xfffe : format, 2, &fmt);
+  Append(channels, 2, &fmt);
+  Append(44100, 4, &fmt);
+  Append(44100 * channels * bits / 8, 4, &fmt);
+  Append(channels * bits / 8, 2, &fmt);
+  Append(bits, 2, &fmt);
+  if (extensible) {
+    Append(22, 2, &fmt);
+    Append(bits, 2, &fmt);
+    Append(0, 4, &fmt);
+    Append(format, 2, &fmt);
+    fmt += std::string(14, '\0');
+  }
+  std::string wav = "RIFF";
+  Append(0, 4, &wav);
+  wav += "WAVE";
+  wav += "fmt ";
+  Append(fmt.size(), 4, &wav);
+  wav += fmt;
+  // An odd-sized chunk before the data, padded to an even size.
+  wav += "LIST";
+  Append(3, 4, &wav);
+  wav += "abc";
+  wav.push_back('\0');
+  wav += "data";
+  Append(data.size(), 4, &wav);
+  wav += data;
+  return wav;
+}
+
+std::vector<double> Ramp(int length) {
+  std::vector<double> values(length);
+  for (int i = 0; i < length; ++i) {
+    values[i] = std::sin(i * 0.37) * 0.9;
+  }
+  return values;
+}
+
+std::vector<double> Decode(const std::string& wav) {
+  std::unique_ptr<WavReader> reader =
+      WavReader::FromBuffer(wav.data(), wav.size());
+  if (reader == nullptr) {
+    return {};
+  }
+  std::vector<double> samples(reader->length());
+  reader->Read(samples.data());
+  return samples;
+}
+
+TEST(WavReaderTest, DecodesMonoFormats) {
+  // Odd lengths cover the scalar tails of the vectorized loops.
+  std::vector<double> values = Ramp(37);
+  struct Case {
+    int bits;
+    bool is_float;
+    double tolerance;
+  };
+  for (const Case& c : {Case{8, false, 1.0 / 128}, Case{16, false, 1.0 / 32768},
+                        Case{24, false, 1.0 / 8388608},
+                        Case{32, false, 1.0 / 2147483648.0},
+                        Case{32, true, 1e-7}}) {
+    std::vector<double> samples =
+        Decode(MakeWav(values, 1, c.bits, c.is_float));
+    ASSERT_EQ(samples.size(), values.size()) << c.bits;
+    for (int i = 0; i < values.size(); ++i) {
+      EXPECT_NEAR(samples[i], values[i], c.tolerance) << c.bits << " " << i;
+    }
+  }
+}
+
+TEST(WavReaderTest, ScalesLikeWorld) {
+  std::vector<double> samples = Decode(MakeWav({-1, 0.5, 0}, 1, 16, false));
+  EXPECT_EQ(samples, (std::vector<double>{-1, 0.5, 0}));
+}
+
+TEST(WavReaderTest, ReadsFirstChannel) {
+  std::vector<double> left = Ramp(5000);
+  std::vector<double> interleaved;
+  for (double value : left) {
+    interleaved.push_back(value);
+    interleaved.push_back(-0.5 * value);
+  }
+  std::string wav = MakeWav(interleaved, 2, 24, false, true);
+  std::unique_ptr<WavReader> reader =
+      WavReader::FromBuffer(wav.data(), wav.size());
+  ASSERT_NE(reader, nullptr);
+  EXPECT_EQ(reader->channels(), 2);
+  EXPECT_EQ(reader->bits(), 24);
+  EXPECT_EQ(reader->fs(), 44100);
+  ASSERT_EQ(reader->length(), left.size());
+  std::vector<double> samples(reader->length());
+  reader->Read(samples.data());
+  for (int i = 0; i < left.size(); ++i) {
+    EXPECT_NEAR(samples[i], left[i], 1e-6) << i;
+  }
+}
+
+TEST(WavReaderTest, ReadsFloatExtensible) {
+  std::vector<double> values = Ramp(10);
+  std::string wav = MakeWav(values, 1, 32, true, true);
+  std::unique_ptr<WavReader> reader =
+      WavReader::FromBuffer(wav.data(), wav.size());
+  ASSERT_NE(reader, nullptr);
+  EXPECT_TRUE(reader->is_float());
+}
+
+TEST(WavReaderTest, BoundsDataByFile) {
+  std::string wav = MakeWav(Ramp(10), 1, 16, false);
+  // Data size left unset by a streaming writer.
+  wav.replace(wav.size() - 24, 4, "\xff\xff\xff\xff", 4);
+  EXPECT_EQ(Decode(wav).size(), 10);
+  std::string zero_size = wav;
+  zero_size.replace(zero_size.size() - 24, 4, "\0\0\0\0", 4);
+  EXPECT_EQ(Decode(zero_size), Decode(wav));
+  // A truncated last sample is dropped.
+  wav.pop_back();
+  EXPECT_EQ(Decode(wav).size(), 9);
+}
+
+TEST(WavReaderTest, RejectsUnsupported) {
+  std::string adpcm = MakeWav(Ramp(10), 1, 16, false);
+  adpcm[20] = 2;
+  EXPECT_EQ(WavReader::FromBuffer(adpcm.data(), adpcm.size()), nullptr);
+  std::string riff("RIFF\0\0\0\0AVI ", 12);
+  EXPECT_EQ(WavReader::FromBuffer(riff.data(), riff.size()), nullptr);
+  std::vector<double> samples;
+  int fs = 0;
+  EXPECT_FALSE(ReadWav("missing.wav", &samples, &fs));
+}
+
+TEST(WavReaderTest, ReadsFiles) {
+  std::vector<double> values = Ramp(100);
+  std::filesystem::path path =
+      std::filesystem::path(testing::TempDir()) / "wav_reader_test.wav";
+  std::ofstream(path, std::ios::binary) << MakeWav(values, 1, 16, false);
+  std::vector<double> samples;
+  int fs = 0;
+  ASSERT_TRUE(ReadWav(path.string(), &samples, &fs));
+  EXPECT_EQ(fs, 44100);
+  ASSERT_EQ(samples.size(), values.size());
+  EXPECT_NEAR(samples[50], values[50], 1.0 / 32768);
+  std::filesystem::remove(path);
+}
+
+}  // namespace
+}  // namespace worldline
@@ -0,0 +1,44 @@
+#include "wav_writer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace worldline {
+
+static void Append(std::uint32_t value, int bytes, std::string* out) {
+  for (int i = 0; i < bytes; ++i) {
+    out->push_back(static_cast<char>(value >> (8 * i)));
+  }
+}
+
+bool WriteWav(const std::string& path, const std::vector<double>& samples,
+              int fs) {
+  std::uint32_t data_bytes = 2 * samples.size();
+  std::string wav;
+  wav.reserve(44 + data_bytes);
+  wav += "RIFF";
+  Append(36 + data_bytes, 4, &wav);
+  wav += "WAVEfmt ";
+  Append(16, 4, &wav);
+  Append(1, 2, &wav);  // PCM
+  Append(1, 2, &wav);  // mono
+  Append(fs, 4, &wav);
+  Append(2 * fs, 4, &wav);
+  Append(2, 2, &wav);
+  Append(16, 2, &wav);
+  wav += "data";
+  Append(data_bytes, 4, &wav);
+  for (double sample : samples) {
+    int value = std::clamp(static_cast<int>(sample * 32767), -32768, 32767);
+    Append(static_cast<std::uint16_t>(value), 2, &wav);
+  }
+  std::ofstream file(std::filesystem::u8path(path),
+                     std::ios::binary | std::ios::trunc);
+  return file.write(wav.data(), wav.size()) && file.flush();
+}
+
+}  // namespace worldline
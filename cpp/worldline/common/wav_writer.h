@@ -0,0 +1,17 @@
+#ifndef WORLDLINE_COMMON_WAV_WRITER_H_
+#define WORLDLINE_COMMON_WAV_WRITER_H_
+
+#include <string>
+#include <vector>
+
+namespace worldline {
+
+// Writes samples to path, UTF-8, as a 16-bit mono PCM wav file, scaled and
+// clipped as WORLD's wavwrite does. Unlike wavwrite, it prints nothing and
+// returns false if the file could not be written in full.
+bool WriteWav(const std::string& path, const std::vector<double>& samples,
+              int fs);
+
+}  // namespace worldline
+
+#endif  // WORLDLINE_COMMON_WAV_WRITER_H_
@@ -0,0 +1,39 @@
+#include "worldline/common/wav_writer.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "worldline/common/wav_reader.h"
+
+namespace worldline {
+namespace {
+
+TEST(WavWriterTest, WritesWhatWavReaderReads) {
+  std::string path =
+      (std::filesystem::path(testing::TempDir()) / "wav_writer.wav").string();
+  ASSERT_TRUE(WriteWav(path, {0, 0.5, -0.5, 2, -2}, 22050));
+  std::vector<double> samples;
+  int fs = 0;
+  ASSERT_TRUE(ReadWav(path, &samples, &fs));
+  EXPECT_EQ(fs, 22050);
+  ASSERT_EQ(samples.size(), 5);
+  EXPECT_EQ(samples[0], 0);
+  EXPECT_NEAR(samples[1], 0.5, 1e-4);
+  EXPECT_NEAR(samples[2], -0.5, 1e-4);
+  // Clipped.
+  EXPECT_NEAR(samples[3], 1, 1e-4);
+  EXPECT_NEAR(samples[4], -1, 1e-4);
+  std::filesystem::remove(path);
+}
+
+TEST(WavWriterTest, FailsOnUnwritablePath) {
+  std::string path = (std::filesystem::path(testing::TempDir()) /
+                      "missing_dir" / "out.wav")
+                         .string();
+  EXPECT_FALSE(WriteWav(path, {0, 0.5}, 44100));
+}
+
+}  // namespace
+}  // namespace worldline
@@ -1,6 +1,7 @@
 #ifndef WORLDLINE_F0_DIO_SS_ESTIMATOR_H_
 #define WORLDLINE_F0_DIO_SS_ESTIMATOR_H_
 
+#include <cstdint>
 #include <vector>
 
 #include "worldline/f0/dio_estimator.h"
@@ -12,6 +13,7 @@ class DioSsEstimator : public DioEstimator {
   void Estimate(const std::vector<double>& samples, int fs, double frame_ms,
                 std::vector<double>* f0,
                 std::vector<double>* time_axis) override;
+  std::uint64_t CacheKey() const override { return 4; }
 };
 
 }  // namespace worldline
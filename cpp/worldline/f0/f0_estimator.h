@@ -1,6 +1,7 @@
 #ifndef WORLDLINE_F0_F0_ESTIMATOR_H_
 #define WORLDLINE_F0_F0_ESTIMATOR_H_
 
+#include <cstdint>
 #include <vector>
 
 namespace worldline {
@@ -10,6 +11,12 @@ class F0Estimator {
   virtual void Estimate(const std::vector<double>& samples, int fs,
                         double frame_ms, std::vector<double>* f0,
                         std::vector<double>* time_axis) = 0;
+  // Identifies the estimator and its settings for caching analysis results.
+  // Results of estimators returning 0 are never cached.
+  virtual std::uint64_t CacheKey() const { return 0; }
+  // Whether f0 of a part of the samples can be estimated from that part
+  // alone.
+  virtual bool SupportsRegion() const { return true; }
 virtual ~F0Estimator() {}
 };
 
@@ -1,6 +1,8 @@
 #include "frq_estimator.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -29,6 +31,28 @@ static double avg_f0(double* data, int count) {
   return sum / non_zeros;
 }
 
+FrqData EstimateFrq(const std::vector<double>& samples, int fs,
+                    F0Estimator* estimator) {
+  FrqData frq_data;
+  frq_data.hop_size = kFrqHopSize;
+  std::vector<double> time_axis;
+  estimator->Estimate(samples, fs, 1000.0 * kFrqHopSize / fs, &frq_data.f0,
+                      &time_axis);
+  frq_data.avg_frq = avg_f0(frq_data.f0.data(), frq_data.f0.size());
+  // Amplitude is the RMS of the hop starting at each frame.
+  frq_data.amp.resize(frq_data.f0.size());
+  for (int i = 0; i < frq_data.amp.size(); ++i) {
+    int begin = std::min<std::size_t>(i * kFrqHopSize, samples.size());
+    int end = std::min<std::size_t>(begin + kFrqHopSize, samples.size());
+    double sum = 0;
+    for (int j = begin; j < end; ++j) {
+      sum += samples[j] * samples[j];
+    }
+    frq_data.amp[i] = end > begin ? std::sqrt(sum / (end - begin)) : 0;
+  }
+  return frq_data;
+}
+
 FrqEstimator::FrqEstimator(const std::string_view frq_data) {
   frq_data_ = LoadFrq(frq_data);
 }
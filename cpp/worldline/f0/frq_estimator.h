@@ -9,6 +9,14 @@
 
 namespace worldline {
 
+// Hop size of frq files written by UTAU tools.
+constexpr int kFrqHopSize = 256;
+
+// Frq data of the whole samples, with f0 estimated by estimator on frames
+// of kFrqHopSize samples.
+FrqData EstimateFrq(const std::vector<double>& samples, int fs,
+                    F0Estimator* estimator);
+
 class FrqEstimator : public F0Estimator {
  public:
   FrqEstimator(const std::string_view frq_data);
@@ -16,6 +24,8 @@ class FrqEstimator : public F0Estimator {
   void Estimate(const std::vector<double>& samples, int fs, double frame_ms,
                 std::vector<double>* f0,
                 std::vector<double>* time_axis) override;
+  // Frq data covers the whole file.
+  bool SupportsRegion() const override { return false; }
 
  private:
   FrqData frq_data_;
@@ -1,6 +1,7 @@
 #ifndef WORLDLINE_F0_HARVEST_ESTIMATOR_H_
 #define WORLDLINE_F0_HARVEST_ESTIMATOR_H_
 
+#include <cstdint>
 #include <vector>
 
 #include "worldline/f0/f0_estimator.h"
@@ -12,6 +13,7 @@ class HarvestEstimator : public F0Estimator {
   void Estimate(const std::vector<double>& samples, int fs, double frame_ms,
                 std::vector<double>* f0,
                 std::vector<double>* time_axis) override;
+  std::uint64_t CacheKey() const override { return 2; }
 };
 
 }  // namespace worldline
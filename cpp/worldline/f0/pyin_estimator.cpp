@@ -1,27 +1,98 @@
 #include "pyin_estimator.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
 #include <vector>
 
+#include "worldline/f0/yin_difference.h"
+
 extern "C" {
 #include "pyin.h"
+#include "pyin-hook.h"
 }
 
 namespace worldline {
 
+constexpr std::uint64_t kPyinCacheKey = 3;
+
+// Narrows the f0 range of config around expected_f0, keeping the density of
+// f0 states of the default range.
+static void NarrowRange(double expected_f0, pyin_config* config) {
+  double fmin = std::max(config->fmin,
+                         expected_f0 * std::pow(2, -kPyinSafetyOctaves));
+  double fmax = std::min(config->fmax,
+                         expected_f0 * std::pow(2, kPyinSafetyOctaves));
+  if (fmin >= fmax) {
+    return;
+  }
+  double states_per_octave =
+      config->nf / std::log2(config->fmax / config->fmin);
+  config->nf = static_cast<int>(
+      std::ceil(states_per_octave * std::log2(fmax / fmin)));
+  config->fmin = fmin;
+  config->fmax = fmax;
+}
+
+// Set while the calling thread runs pyin_analyze for PyinMethod::kFft.
+static thread_local bool fft_yincorr = false;
+
+// Stands in for pyin_yincorr on the threads that set fft_yincorr. Each
+// thread keeps the plans of its last frame size.
+static double* FftYincorr(double* x, int nx, int w) {
+  if (!fft_yincorr) {
+    return nullptr;
+  }
+  thread_local std::unique_ptr<YinDifference> yin;
+  int max_lag = nx - w - 1;
+  if (!yin || yin->window() != w || yin->max_lag() != max_lag) {
+    yin = std::make_unique<YinDifference>(w, max_lag);
+  }
+  // Freed by libpyin.
+  double* difference =
+      static_cast<double*>(std::malloc((max_lag + 1) * sizeof(double)));
+  yin->Compute(x, difference);
+  return difference;
+}
+
+std::uint64_t PyinEstimator::CacheKey() const {
+  std::uint64_t key =
+      kPyinCacheKey | static_cast<std::uint64_t>(method_) << 4;
+  if (expected_f0_ <= 0) {
+    return key;
+  }
+  // Expected f0 comes from tones, so centihertz tell ranges apart.
+  return key | static_cast<std::uint64_t>(std::llround(expected_f0_ * 100))
+                   << 8;
+}
+
 void PyinEstimator::Estimate(const std::vector<double>& samples, int fs,
                              double frame_ms, std::vector<double>* f0,
                              std::vector<double>* time_axis) {
   int nhop = static_cast<int>(std::round(fs * frame_ms / 1000.0));
-  int f0_len = 0;
   pyin_config config = pyin_init(nhop);
+  if (expected_f0_ > 0) {
+    NarrowRange(expected_f0_, &config);
+  }
+  // The hook is shared by all threads, and passes on the frames of threads
+  // running kLibpyin.
+  static const bool hooked = []() {
+    pyin_yincorr_hook = FftYincorr;
+    return true;
+  }();
+  (void)hooked;
+  fft_yincorr = method_ == PyinMethod::kFft;
+  int f0_len = 0;
   double* raw_f0 = pyin_analyze(config, const_cast<double*>(samples.data()),
                                 samples.size(), fs, &f0_len);
+  fft_yincorr = false;
   // shift left by 1
   *f0 = std::vector<double>(f0_len - 1);
-  *time_axis = std::vector<double>(f0_len - 1);
   std::copy(raw_f0 + 1, raw_f0 + f0_len, f0->data());
   delete[] raw_f0;
+  *time_axis = std::vector<double>(f0->size());
   for (int i = 0; i < time_axis->size(); ++i) {
     time_axis->data()[i] = 1.0 * nhop * i / fs;
   }
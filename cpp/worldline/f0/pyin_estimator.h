@@ -1,17 +1,44 @@
 #ifndef WORLDLINE_F0_PYIN_ESTIMATOR_H_
 #define WORLDLINE_F0_PYIN_ESTIMATOR_H_
 
+#include <cstdint>
 #include <vector>
 
 #include "worldline/f0/f0_estimator.h"
 
 namespace worldline {
 
+// Octaves searched on each side of an expected f0.
+constexpr double kPyinSafetyOctaves = 1;
+
+// Implementation of pyin.
+enum class PyinMethod {
+  // pyin_analyze of libpyin.
+  kLibpyin = 0,
+  // pyin_analyze with the YIN difference of each frame taken from
+  // YinDifference through pyin_yincorr_hook, which costs a few FFTs per frame
+  // instead of a sum per lag.
+  kFft = 1,
+};
+
 class PyinEstimator : public F0Estimator {
  public:
+  PyinEstimator() = default;
+  // Only searches f0 within kPyinSafetyOctaves of expected_f0, in Hz, which
+  // shrinks the YIN lag range and the Viterbi states. Searches the default
+  // range if expected_f0 is 0.
+  explicit PyinEstimator(double expected_f0) : expected_f0_(expected_f0) {}
+  PyinEstimator(double expected_f0, PyinMethod method)
+      : expected_f0_(expected_f0), method_(method) {}
+
   void Estimate(const std::vector<double>& samples, int fs, double frame_ms,
                 std::vector<double>* f0,
                 std::vector<double>* time_axis) override;
+  std::uint64_t CacheKey() const override;
+
+ private:
+  double expected_f0_ = 0;
+  PyinMethod method_ = PyinMethod::kLibpyin;
 };
 
 }  // namespace worldline
@@ -0,0 +1,129 @@
+#include "worldline/f0/pyin_estimator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace worldline {
+namespace {
+
+constexpr int kFs = 44100;
+constexpr double kFrameMs = 10;
+// Frames near the ends of the tones are left out of comparisons.
+constexpr int kEdgeFrames = 10;
+
+// Two seconds of a harmonic tone with vibrato around base_f0, and its f0 on
+// 10 ms frames.
+std::vector<double> Tone(double base_f0, std::vector<double>* f0) {
+  constexpr double kPi = 3.14159265358979323846;
+  std::vector<double> samples(kFs * 2);
+  double phase = 0;
+  for (int i = 0; i < samples.size(); ++i) {
+    double t = static_cast<double>(i) / kFs;
+    double f = base_f0 * std::pow(2, 0.3 / 12 * std::sin(2 * kPi * 5 * t));
+    if (i % (kFs / 100) == 0) {
+      f0->push_back(f);
+    }
+    phase += 2 * kPi * f / kFs;
+    double sample = 0;
+    for (int h = 1; h <= 20 && h * f < kFs / 2; ++h) {
+      sample += std::sin(h * phase) / h;
+    }
+    samples[i] = 0.2 * sample;
+  }
+  return samples;
+}
+
+// Median deviation in cents over frames voiced in both tracks, away from the
+// ends, and the share of those frames voiced in both.
+void Compare(const std::vector<double>& expected,
+             const std::vector<double>& actual, double* median_cents,
+             double* voiced_ratio) {
+  *median_cents = INFINITY;
+  *voiced_ratio = 0;
+  std::vector<double> cents;
+  int frames = 0;
+  int length = std::min(expected.size(), actual.size());
+  for (int i = kEdgeFrames; i < length - kEdgeFrames; ++i) {
+    frames++;
+    if (expected[i] > 0 && actual[i] > 0) {
+      cents.push_back(std::abs(1200 * std::log2(actual[i] / expected[i])));
+    }
+  }
+  ASSERT_FALSE(cents.empty());
+  std::nth_element(cents.begin(), cents.begin() + cents.size() / 2,
+                   cents.end());
+  *median_cents = cents[cents.size() / 2];
+  *voiced_ratio = static_cast<double>(cents.size()) / frames;
+}
+
+class PyinEstimatorTest : public ::testing::TestWithParam<double> {};
+
+TEST_P(PyinEstimatorTest, FftTracksTones) {
+  std::vector<double> truth;
+  std::vector<double> samples = Tone(GetParam(), &truth);
+  PyinEstimator estimator(0, PyinMethod::kFft);
+  std::vector<double> f0;
+  std::vector<double> ts;
+  estimator.Estimate(samples, kFs, kFrameMs, &f0, &ts);
+  ASSERT_EQ(f0.size(), ts.size());
+  double median_cents;
+  double voiced_ratio;
+  Compare(truth, f0, &median_cents, &voiced_ratio);
+  EXPECT_LT(median_cents, 10);
+  EXPECT_GT(voiced_ratio, 0.95);
+}
+
+TEST_P(PyinEstimatorTest, FftMatchesLibpyin) {
+  std::vector<double> truth;
+  std::vector<double> samples = Tone(GetParam(), &truth);
+  std::vector<double> libpyin_f0;
+  std::vector<double> fft_f0;
+  std::vector<double> ts;
+  PyinEstimator(0, PyinMethod::kLibpyin)
+      .Estimate(samples, kFs, kFrameMs, &libpyin_f0, &ts);
+  PyinEstimator(0, PyinMethod::kFft)
+      .Estimate(samples, kFs, kFrameMs, &fft_f0, &ts);
+  double median_cents;
+  double voiced_ratio;
+  Compare(libpyin_f0, fft_f0, &median_cents, &voiced_ratio);
+  EXPECT_LT(median_cents, 10);
+  EXPECT_GT(voiced_ratio, 0.9);
+}
+
+TEST_P(PyinEstimatorTest, NarrowedRangeMatchesFullSearch) {
+  std::vector<double> truth;
+  std::vector<double> samples = Tone(GetParam(), &truth);
+  for (PyinMethod method : {PyinMethod::kLibpyin, PyinMethod::kFft}) {
+    std::vector<double> full_f0;
+    std::vector<double> narrow_f0;
+    std::vector<double> ts;
+    PyinEstimator(0, method).Estimate(samples, kFs, kFrameMs, &full_f0, &ts);
+    // Expected a semitone off, as a pitch label is only a hint.
+    PyinEstimator(GetParam() * std::pow(2, 1 / 12.0), method)
+        .Estimate(samples, kFs, kFrameMs, &narrow_f0, &ts);
+    ASSERT_EQ(narrow_f0.size(), full_f0.size());
+    double median_cents;
+    double voiced_ratio;
+    Compare(full_f0, narrow_f0, &median_cents, &voiced_ratio);
+    EXPECT_LT(median_cents, 2) << static_cast<int>(method);
+    EXPECT_GT(voiced_ratio, 0.95) << static_cast<int>(method);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Tones, PyinEstimatorTest,
+                         ::testing::Values(110.0, 220.0, 440.0));
+
+TEST(PyinEstimatorCacheKeyTest, DependsOnRangeAndMethod) {
+  EXPECT_EQ(PyinEstimator().CacheKey(), 3);
+  EXPECT_NE(PyinEstimator(220).CacheKey(), PyinEstimator().CacheKey());
+  EXPECT_NE(PyinEstimator(0, PyinMethod::kFft).CacheKey(),
+            PyinEstimator().CacheKey());
+  EXPECT_NE(PyinEstimator(220, PyinMethod::kFft).CacheKey(),
+            PyinEstimator(220).CacheKey());
+}
+
+}  // namespace
+}  // namespace worldline
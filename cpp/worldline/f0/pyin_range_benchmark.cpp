@@ -0,0 +1,225 @@
+// Compares pyin over its default f0 range with pyin narrowed around the
+// expected tone, for speed and for agreement of the f0 tracks.
+//
+// usage: pyin_range_benchmark [--tone=<midi>] [<voicebank dir or wav>...]
+//
+// The tone of a wav is parsed from a pitch label ending its file or folder
+// name, e.g. "ka_C4.wav" or "A3/ka.wav", and falls back to --tone. Wavs
+// without either are skipped. Without paths, harmonic tones with vibrato are
+// generated instead, and both tracks are also compared with the known f0.
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "audioio.h"
+#include "worldline/f0/pyin_estimator.h"
+
+namespace {
+
+constexpr int kFs = 44100;
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kFrameMs = 10;
+// Deviations above this many cents count as gross errors.
+constexpr double kGrossCents = 50;
+
+struct Input {
+  std::string name;
+  std::vector<double> samples;
+  int fs;
+  int tone;
+  // Known f0 of generated inputs, empty for wavs.
+  std::vector<double> truth;
+};
+
+struct Comparison {
+  // Frames voiced in the reference and in the track.
+  int compared = 0;
+  // Frames voiced in only one of them.
+  int voicing_mismatches = 0;
+  int frames = 0;
+  double cents = 0;
+  int gross = 0;
+
+  void Add(const std::vector<double>& reference,
+           const std::vector<double>& f0) {
+    int length = std::min(reference.size(), f0.size());
+    for (int i = 0; i < length; ++i) {
+      frames++;
+      if ((reference[i] > 0) != (f0[i] > 0)) {
+        voicing_mismatches++;
+      } else if (reference[i] > 0) {
+        double error = std::abs(1200 * std::log2(f0[i] / reference[i]));
+        compared++;
+        cents += error;
+        gross += error > kGrossCents ? 1 : 0;
+      }
+    }
+  }
+
+  void Print(const std::string& name) const {
+    std::cout << "  " << name << ": mean "
+              << (compared > 0 ? cents / compared : 0) << " cents, gross "
+              << (compared > 0 ? 100.0 * gross / compared : 0)
+              << "%, voicing mismatch "
+              << (frames > 0 ? 100.0 * voicing_mismatches / frames : 0) << "%"
+              << std::endl;
+  }
+};
+
+// Parses a pitch label such as "C4" or "A#3" at the end of name.
+bool ParseToneSuffix(std::string_view name, int* tone) {
+  static constexpr int kNoteTones[] = {9, 11, 0, 2, 4, 5, 7};  // A to G
+  if (name.size() < 2 ||
+      !std::isdigit(static_cast<unsigned char>(name.back()))) {
+    return false;
+  }
+  int octave = name.back() - '0';
+  name.remove_suffix(1);
+  bool sharp = name.back() == '#';
+  if (sharp) {
+    name.remove_suffix(1);
+  }
+  if (name.empty() || name.back() < 'A' || name.back() > 'G') {
+    return false;
+  }
+  *tone = 12 * (octave + 1) + kNoteTones[name.back() - 'A'] + (sharp ? 1 : 0);
+  return true;
+}
+
+bool ToneOfPath(const std::filesystem::path& path, int* tone) {
+  return ParseToneSuffix(path.stem().string(), tone) ||
+         ParseToneSuffix(path.parent_path().filename().string(), tone);
+}
+
+std::vector<Input> Generate() {
+  std::vector<Input> inputs;
+  for (int tone = 45; tone <= 77; tone += 4) {
+    Input input;
+    input.name = "tone " + std::to_string(tone);
+    input.fs = kFs;
+    input.tone = tone;
+    double base = 440 * std::pow(2, (tone - 69) / 12.0);
+    int length = kFs * 2;
+    input.samples.resize(length);
+    double phase = 0;
+    for (int i = 0; i < length; ++i) {
+      double t = static_cast<double>(i) / kFs;
+      double f = base * std::pow(2, 0.4 / 12 * std::sin(2 * kPi * 5.5 * t));
+      phase += 2 * kPi * f / kFs;
+      double sample = 0;
+      for (int h = 1; h * f < kFs / 2 && h <= 30; ++h) {
+        sample += std::sin(h * phase) / h;
+      }
+      input.samples[i] = 0.2 * sample;
+    }
+    for (double t = 0; t * kFs < length; t += kFrameMs / 1000) {
+      input.truth.push_back(
+          base * std::pow(2, 0.4 / 12 * std::sin(2 * kPi * 5.5 * t)));
+    }
+    inputs.push_back(std::move(input));
+  }
+  return inputs;
+}
+
+void AddWav(const std::filesystem::path& path, int default_tone,
+            std::vector<Input>* inputs) {
+  int tone = default_tone;
+  if (!ToneOfPath(path, &tone) && tone <= 0) {
+    std::cout << "skipped " << path.string() << ": no pitch label"
+              << std::endl;
+    return;
+  }
+  Input input;
+  input.name = path.string();
+  input.tone = tone;
+  input.samples.resize(GetAudioLength(path.string().c_str()));
+  int nbit;
+  wavread(path.string().c_str(), &input.fs, &nbit, input.samples.data());
+  inputs->push_back(std::move(input));
+}
+
+double Estimate(worldline::PyinEstimator& estimator, const Input& input,
+                std::vector<double>* f0) {
+  std::vector<double> ts;
+  auto start = std::chrono::steady_clock::now();
+  estimator.Estimate(input.samples, input.fs, kFrameMs, f0, &ts);
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int default_tone = 0;
+  std::vector<Input> inputs;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg(argv[i]);
+    if (arg.substr(0, 7) == "--tone=") {
+      default_tone = std::stoi(std::string(arg.substr(7)));
+      continue;
+    }
+    std::filesystem::path path(arg);
+    if (!std::filesystem::is_directory(path)) {
+      AddWav(path, default_tone, &inputs);
+      continue;
+    }
+    std::vector<std::filesystem::path> wavs;
+    for (const auto& entry :
+         std::filesystem::recursive_directory_iterator(path)) {
+      if (entry.is_regular_file() && entry.path().extension() == ".wav") {
+        wavs.push_back(entry.path());
+      }
+    }
+    std::sort(wavs.begin(), wavs.end());
+    for (const auto& wav : wavs) {
+      AddWav(wav, default_tone, &inputs);
+    }
+  }
+  if (argc == 1) {
+    inputs = Generate();
+  }
+
+  Comparison narrowed;
+  Comparison default_truth;
+  Comparison narrowed_truth;
+  double default_seconds = 0;
+  double narrowed_seconds = 0;
+  for (const Input& input : inputs) {
+    worldline::PyinEstimator full;
+    worldline::PyinEstimator narrow(440 *
+                                    std::pow(2, (input.tone - 69) / 12.0));
+    std::vector<double> full_f0;
+    std::vector<double> narrow_f0;
+    double full_seconds = Estimate(full, input, &full_f0);
+    double narrow_seconds = Estimate(narrow, input, &narrow_f0);
+    std::cout << input.name << ": " << full_seconds << " s -> "
+              << narrow_seconds << " s" << std::endl;
+    default_seconds += full_seconds;
+    narrowed_seconds += narrow_seconds;
+    narrowed.Add(full_f0, narrow_f0);
+    if (!input.truth.empty()) {
+      default_truth.Add(input.truth, full_f0);
+      narrowed_truth.Add(input.truth, narrow_f0);
+    }
+  }
+
+  std::cout << inputs.size() << " inputs" << std::endl;
+  std::cout << "  default range: " << default_seconds << " s" << std::endl;
+  std::cout << "  narrowed range: " << narrowed_seconds << " s ("
+            << (narrowed_seconds > 0 ? default_seconds / narrowed_seconds : 0)
+            << "x)" << std::endl;
+  narrowed.Print("narrowed vs default");
+  if (default_truth.frames > 0) {
+    default_truth.Print("default vs truth");
+    narrowed_truth.Print("narrowed vs truth");
+  }
+  return 0;
+}
@@ -0,0 +1,97 @@
+#include "yin_difference.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "world/fft.h"
+
+namespace worldline {
+
+// Turns differences d(tau) into d'(tau) = d(tau) * tau / sum of d(1..tau).
+static void Normalize(int max_lag, double* difference) {
+  difference[0] = 1;
+  double sum = 0;
+  for (int tau = 1; tau <= max_lag; ++tau) {
+    sum += difference[tau];
+    difference[tau] = sum > 0 ? difference[tau] * tau / sum : 1;
+  }
+}
+
+YinDifference::YinDifference(int window, int max_lag)
+    : window_(window), max_lag_(max_lag) {
+  // Correlations up to max_lag never wrap around.
+  fft_size_ = 1;
+  while (fft_size_ < window + max_lag) {
+    fft_size_ *= 2;
+  }
+  waveform_.resize(fft_size_);
+  correlation_.resize(fft_size_);
+  window_spectrum_ = std::make_unique<fft_complex[]>(fft_size_ / 2 + 1);
+  frame_spectrum_ = std::make_unique<fft_complex[]>(fft_size_ / 2 + 1);
+  window_fft_ = fft_plan_dft_r2c_1d(fft_size_, waveform_.data(),
+                                    window_spectrum_.get(), FFT_ESTIMATE);
+  frame_fft_ = fft_plan_dft_r2c_1d(fft_size_, waveform_.data(),
+                                   frame_spectrum_.get(), FFT_ESTIMATE);
+  inverse_fft_ = fft_plan_dft_c2r_1d(fft_size_, frame_spectrum_.get(),
+                                     correlation_.data(), FFT_ESTIMATE);
+}
+
+YinDifference::~YinDifference() {
+  fft_destroy_plan(window_fft_);
+  fft_destroy_plan(frame_fft_);
+  fft_destroy_plan(inverse_fft_);
+}
+
+void YinDifference::Compute(const double* x, double* result) {
+  // r(tau) = sum of x[j] * x[j + tau] over j in [0, window), from the
+  // spectrum of the first window samples and of the whole frame.
+  std::fill(std::copy(x, x + window_, waveform_.begin()), waveform_.end(), 0);
+  fft_execute(window_fft_);
+  int length = frame_length();
+  std::fill(std::copy(x, x + length, waveform_.begin()), waveform_.end(), 0);
+  fft_execute(frame_fft_);
+  for (int k = 0; k <= fft_size_ / 2; ++k) {
+    double re0 = window_spectrum_[k][0];
+    double im0 = window_spectrum_[k][1];
+    double re1 = frame_spectrum_[k][0];
+    double im1 = frame_spectrum_[k][1];
+    frame_spectrum_[k][0] = re0 * re1 + im0 * im1;
+    frame_spectrum_[k][1] = re0 * im1 - im0 * re1;
+  }
+  fft_execute(inverse_fft_);
+
+  // d(tau) = e(0) + e(tau) - 2 r(tau), e(tau) being the energy of
+  // x[tau, tau + window).
+  double energy0 = 0;
+  for (int j = 0; j < window_; ++j) {
+    energy0 += x[j] * x[j];
+  }
+  double energy = energy0;
+  double scale = 1.0 / fft_size_;
+  for (int tau = 0; tau <= max_lag_; ++tau) {
+    if (tau > 0) {
+      double out = x[tau - 1];
+      double in = x[tau + window_ - 1];
+      energy += in * in - out * out;
+    }
+    result[tau] =
+        std::max(0.0, energy0 + energy - 2 * correlation_[tau] * scale);
+  }
+  Normalize(max_lag_, result);
+}
+
+void YinDifference::ComputeDirect(const double* x, int window, int max_lag,
+                                  double* result) {
+  for (int tau = 0; tau <= max_lag; ++tau) {
+    double sum = 0;
+    for (int j = 0; j < window; ++j) {
+      double delta = x[j] - x[j + tau];
+      sum += delta * delta;
+    }
+    result[tau] = sum;
+  }
+  Normalize(max_lag, result);
+}
+
+}  // namespace worldline
@@ -0,0 +1,49 @@
+#ifndef WORLDLINE_F0_YIN_DIFFERENCE_H_
+#define WORLDLINE_F0_YIN_DIFFERENCE_H_
+
+#include <memory>
+#include <vector>
+
+#include "world/fft.h"
+
+namespace worldline {
+
+// Cumulative mean normalized difference of YIN over frames of window
+// samples, for lags up to max_lag. The difference is built from one
+// cross-correlation by FFT rather than a sum per lag, and the FFT plans and
+// buffers are made once and reused by every frame. Not thread safe.
+class YinDifference {
+ public:
+  YinDifference(int window, int max_lag);
+  ~YinDifference();
+  YinDifference(const YinDifference&) = delete;
+  YinDifference& operator=(const YinDifference&) = delete;
+
+  int window() const { return window_; }
+  int max_lag() const { return max_lag_; }
+  // Samples read from each frame.
+  int frame_length() const { return window_ + max_lag_; }
+
+  // Writes d'(tau) of x[0, frame_length()) for tau in [0, max_lag] to
+  // result.
+  void Compute(const double* x, double* result);
+  // Same as Compute, with a sum per lag. Reference for tests.
+  static void ComputeDirect(const double* x, int window, int max_lag,
+                            double* result);
+
+ private:
+  int window_;
+  int max_lag_;
+  int fft_size_;
+  std::vector<double> waveform_;
+  std::vector<double> correlation_;
+  std::unique_ptr<fft_complex[]> window_spectrum_;
+  std::unique_ptr<fft_complex[]> frame_spectrum_;
+  fft_plan window_fft_;
+  fft_plan frame_fft_;
+  fft_plan inverse_fft_;
+};
+
+}  // namespace worldline
+
+#endif  // WORLDLINE_F0_YIN_DIFFERENCE_H_
@@ -0,0 +1,50 @@
+#include "worldline/f0/yin_difference.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace worldline {
+namespace {
+
+TEST(YinDifferenceTest, MatchesDirectSums) {
+  constexpr int kWindow = 500;
+  constexpr int kMaxLag = 400;
+  std::mt19937 random(7);
+  std::normal_distribution<double> noise(0, 0.05);
+  std::vector<double> x(kWindow + kMaxLag);
+  for (int i = 0; i < x.size(); ++i) {
+    x[i] = 0.5 * std::sin(i * 0.07) + 0.2 * std::sin(i * 0.21) +
+           noise(random);
+  }
+  YinDifference yin(kWindow, kMaxLag);
+  std::vector<double> fft(kMaxLag + 1);
+  std::vector<double> direct(kMaxLag + 1);
+  // Twice, as plans and buffers are reused.
+  for (int run = 0; run < 2; ++run) {
+    yin.Compute(x.data(), fft.data());
+    YinDifference::ComputeDirect(x.data(), kWindow, kMaxLag, direct.data());
+    for (int tau = 0; tau <= kMaxLag; ++tau) {
+      EXPECT_NEAR(fft[tau], direct[tau], 1e-9) << tau;
+    }
+  }
+}
+
+TEST(YinDifferenceTest, DipsAtThePeriod) {
+  constexpr int kPeriod = 100;
+  YinDifference yin(300, 250);
+  std::vector<double> x(yin.frame_length());
+  for (int i = 0; i < x.size(); ++i) {
+    x[i] = std::sin(2 * 3.14159265358979323846 * i / kPeriod);
+  }
+  std::vector<double> d(yin.max_lag() + 1);
+  yin.Compute(x.data(), d.data());
+  EXPECT_EQ(d[0], 1);
+  EXPECT_LT(d[kPeriod], 1e-6);
+  EXPECT_GT(d[kPeriod / 2], 1);
+}
+
+}  // namespace
+}  // namespace worldline
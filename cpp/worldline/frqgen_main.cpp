@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/debugging/failure_signal_handler.h"
+#include "absl/debugging/symbolize.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/strings/match.h"
+#include "worldline/classic/frq.h"
+#include "worldline/common/thread_pool.h"
+#include "worldline/common/wav_reader.h"
+#include "worldline/f0/frq_estimator.h"
+#include "worldline/f0/harvest_estimator.h"
+#include "worldline/f0/pyin_estimator.h"
+#include "xxhash.h"
+
+ABSL_FLAG(std::string, estimator, "pyin",
+          "F0 estimator: pyin, pyin_fft or harvest.");
+ABSL_FLAG(int, threads, 0, "Number of workers. 0 uses all cores.");
+ABSL_FLAG(bool, force, false, "Regenerates up-to-date frq files too.");
+
+// Lists the wav content hash and estimator behind each generated frq file,
+// relative to the voicebank.
+constexpr char kManifestFileName[] = "frqgen.manifest";
+
+namespace {
+
+struct ManifestEntry {
+  std::uint64_t wav_hash;
+  std::uint64_t estimator_key;
+};
+
+using Manifest = std::unordered_map<std::string, ManifestEntry>;
+
+enum class Status { kGenerated, kUpToDate, kFailed };
+
+struct Job {
+  std::filesystem::path wav_path;
+  std::uintmax_t wav_size;
+  Status status = Status::kFailed;
+  double audio_seconds = 0;
+  ManifestEntry entry = {};
+  bool has_entry = false;
+};
+
+std::unique_ptr<worldline::F0Estimator> MakeEstimator(
+    const std::string& name) {
+  if (name == "pyin") {
+    return std::make_unique<worldline::PyinEstimator>();
+  }
+  if (name == "pyin_fft") {
+    return std::make_unique<worldline::PyinEstimator>(
+        0, worldline::PyinMethod::kFft);
+  }
+  if (name == "harvest") {
+    return std::make_unique<worldline::HarvestEstimator>();
+  }
+  return nullptr;
+}
+
+// Lines of "<wav hash> <estimator key> <wav path>", hashes in hex.
+Manifest ReadManifest(const std::filesystem::path& path) {
+  Manifest manifest;
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream stream(line);
+    ManifestEntry entry;
+    std::string wav;
+    if (stream >> std::hex >> entry.wav_hash >> entry.estimator_key &&
+        stream.get() == ' ' && std::getline(stream, wav)) {
+      manifest[wav] = entry;
+    }
+  }
+  return manifest;
+}
+
+bool HashFile(const std::filesystem::path& path, std::uint64_t* hash) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  std::string data((std::istreambuf_iterator<char>(file)),
+                   std::istreambuf_iterator<char>());
+  *hash = XXH3_64bits(data.data(), data.size());
+  return true;
+}
+
+// Up to date when newer than the wav, or when the wav still has the content
+// it was generated from, e.g. after a checkout touched it. Either way it must
+// come from the same estimator if the manifest knows it.
+bool IsUpToDate(const Job& job, const std::filesystem::path& frq_path,
+                const ManifestEntry* known, std::uint64_t estimator_key,
+                std::uint64_t* wav_hash) {
+  std::error_code error;
+  auto frq_time = std::filesystem::last_write_time(frq_path, error);
+  if (error) {
+    return false;
+  }
+  if (known != nullptr && known->estimator_key != estimator_key) {
+    return false;
+  }
+  auto wav_time = std::filesystem::last_write_time(job.wav_path, error);
+  if (!error && frq_time >= wav_time) {
+    return true;
+  }
+  return known != nullptr && HashFile(job.wav_path, wav_hash) &&
+         *wav_hash == known->wav_hash;
+}
+
+void Process(const std::string& estimator_name, const Manifest& manifest,
+             bool force, const std::filesystem::path& root, Job* job) {
+  std::string key = job->wav_path.lexically_relative(root).generic_string();
+  auto known = manifest.find(key);
+  const ManifestEntry* known_entry =
+      known == manifest.end() ? nullptr : &known->second;
+  std::unique_ptr<worldline::F0Estimator> estimator =
+      MakeEstimator(estimator_name);
+  std::string frq_path = worldline::FrqPath(job->wav_path.string());
+  std::uint64_t wav_hash = 0;
+  if (!force && IsUpToDate(*job, frq_path, known_entry,
+                           estimator->CacheKey(), &wav_hash)) {
+    job->status = Status::kUpToDate;
+    if (known_entry != nullptr) {
+      job->entry = *known_entry;
+      job->has_entry = true;
+    }
+    return;
+  }
+  if (!HashFile(job->wav_path, &wav_hash)) {
+    return;
+  }
+  std::vector<double> samples;
+  int fs;
+  if (!worldline::ReadWav(job->wav_path.string(), &samples, &fs) ||
+      samples.empty()) {
+    return;
+  }
+  std::string data = worldline::DumpFrq(
+      worldline::EstimateFrq(samples, fs, estimator.get()));
+  if (!worldline::WriteFrqFile(frq_path, data)) {
+    return;
+  }
+  job->status = Status::kGenerated;
+  job->audio_seconds = static_cast<double>(samples.size()) / fs;
+  job->entry = ManifestEntry{wav_hash, estimator->CacheKey()};
+  job->has_entry = true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  absl::InitializeSymbolizer(argv[0]);
+  absl::FailureSignalHandlerOptions options;
+  absl::InstallFailureSignalHandler(options);
+
+  std::vector<char*> args = absl::ParseCommandLine(argc, argv);
+  if (args.size() < 2) {
+    std::cout << "usage: frqgen [--estimator=pyin|pyin_fft|harvest] "
+                 "[--threads=<n>] [--force] <voicebank dir>"
+              << std::endl;
+    return 1;
+  }
+  std::filesystem::path root(args[1]);
+  std::string estimator_name = absl::GetFlag(FLAGS_estimator);
+  if (MakeEstimator(estimator_name) == nullptr) {
+    std::cout << "unknown estimator " << estimator_name << std::endl;
+    return 1;
+  }
+  bool force = absl::GetFlag(FLAGS_force);
+
+  std::vector<Job> jobs;
+  for (const auto& entry :
+       std::filesystem::recursive_directory_iterator(root)) {
+    // Voicebanks made on Windows often have upper case ".WAV".
+    if (entry.is_regular_file() &&
+        absl::EqualsIgnoreCase(entry.path().extension().string(), ".wav")) {
+      jobs.push_back(Job{entry.path(), entry.file_size()});
+    }
+  }
+  if (jobs.empty()) {
+    std::cout << "no wav files found in " << root << std::endl;
+    return 1;
+  }
+  // Longest files first, so that the last ones to finish are short.
+  std::sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) {
+    return a.wav_size > b.wav_size;
+  });
+  std::filesystem::path manifest_path = root / kManifestFileName;
+  Manifest manifest = ReadManifest(manifest_path);
+
+  int threads = absl::GetFlag(FLAGS_threads);
+  // The calling thread takes part in ParallelFor, so it is not counted.
+  std::unique_ptr<worldline::ThreadPool> own_pool;
+  if (threads > 0) {
+    own_pool = std::make_unique<worldline::ThreadPool>(threads - 1);
+  }
+  worldline::ThreadPool& pool =
+      own_pool ? *own_pool : worldline::ThreadPool::Global();
+
+  std::mutex output_mutex;
+  auto start = std::chrono::steady_clock::now();
+  pool.ParallelFor(static_cast<int>(jobs.size()), [&](int i) {
+    Process(estimator_name, manifest, force, root, &jobs[i]);
+    if (jobs[i].status == Status::kFailed) {
+      std::lock_guard<std::mutex> lock(output_mutex);
+      std::cout << "failed " << jobs[i].wav_path.string() << std::endl;
+    }
+  });
+  double elapsed = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  int generated = 0;
+  int up_to_date = 0;
+  int failed = 0;
+  double audio_seconds = 0;
+  std::ostringstream manifest_data;
+  for (const Job& job : jobs) {
+    generated += job.status == Status::kGenerated ? 1 : 0;
+    up_to_date += job.status == Status::kUpToDate ? 1 : 0;
+    failed += job.status == Status::kFailed ? 1 : 0;
+    audio_seconds += job.audio_seconds;
+    if (job.has_entry) {
+      manifest_data << std::hex << job.entry.wav_hash << " "
+                    << job.entry.estimator_key << " "
+                    << job.wav_path.lexically_relative(root).generic_string()
+                    << "\n";
+    }
+  }
+  // Written like frq files, so that an interrupted run leaves the old one.
+  if (!worldline::WriteFrqFile(manifest_path, manifest_data.str())) {
+    std::cout << "cannot write " << manifest_path.string() << std::endl;
+  }
+
+  std::cout << "generated " << generated << ", up to date " << up_to_date
+            << ", failed " << failed << " of " << jobs.size() << " files in "
+            << elapsed << "s" << std::endl;
+  if (elapsed > 0) {
+    std::cout << "  " << generated / elapsed << " files/s, "
+              << audio_seconds / elapsed << " audio s/s on "
+              << pool.size() + 1 << " threads" << std::endl;
+  }
+  return failed > 0 ? 1 : 0;
+}
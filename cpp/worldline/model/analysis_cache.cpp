@@ -0,0 +1,115 @@
+#include "analysis_cache.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "xxhash.h"
+
+namespace worldline {
+
+bool AnalysisKey::operator==(const AnalysisKey& other) const {
+  return content_hash == other.content_hash && options == other.options &&
+         fs == other.fs && kind == other.kind && frame_ms == other.frame_ms;
+}
+
+std::size_t AnalysisData::Bytes() const {
+  std::size_t bytes = sizeof(AnalysisData);
+  bytes += (f0.size() + ts.size()) * sizeof(double);
+  bytes += frames.rows() * frames.stride() * sizeof(double);
+  return bytes;
+}
+
+std::uint64_t HashBuffer(const double* data, std::size_t length,
+                         std::uint64_t seed) {
+  return XXH3_64bits_withSeed(data, length * sizeof(double), seed);
+}
+
+std::size_t AnalysisCache::KeyHash::operator()(const AnalysisKey& key) const {
+  return static_cast<std::size_t>(key.content_hash ^ (key.options << 1) ^
+                                  (static_cast<std::uint64_t>(key.kind) << 3));
+}
+
+AnalysisCache& AnalysisCache::Global() {
+  static AnalysisCache* cache = new AnalysisCache(kDefaultBudgetBytes);
+  return *cache;
+}
+
+AnalysisCache::AnalysisCache(std::size_t budget_bytes)
+    : budget_bytes_(budget_bytes) {}
+
+bool AnalysisCache::enabled() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return budget_bytes_ > 0;
+}
+
+std::shared_ptr<const AnalysisData> AnalysisCache::Get(
+    const AnalysisKey& key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    misses_++;
+    return nullptr;
+  }
+  hits_++;
+  lru_.splice(lru_.begin(), lru_, it->second);
+  return it->second->data;
+}
+
+void AnalysisCache::Put(const AnalysisKey& key,
+                        std::shared_ptr<const AnalysisData> data) {
+  std::size_t bytes = data->Bytes();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (bytes > budget_bytes_) {
+    return;
+  }
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    bytes_ -= it->second->bytes;
+    lru_.erase(it->second);
+    index_.erase(it);
+  }
+  lru_.push_front(Entry{key, std::move(data), bytes});
+  index_[key] = lru_.begin();
+  bytes_ += bytes;
+  EvictLocked();
+}
+
+void AnalysisCache::SetBudget(std::size_t budget_bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  budget_bytes_ = budget_bytes;
+  EvictLocked();
+}
+
+void AnalysisCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  lru_.clear();
+  index_.clear();
+  bytes_ = 0;
+}
+
+AnalysisCache::Stats AnalysisCache::GetStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats;
+  stats.hits = hits_;
+  stats.misses = misses_;
+  stats.evictions = evictions_;
+  stats.entries = static_cast<std::int64_t>(lru_.size());
+  stats.bytes = static_cast<std::int64_t>(bytes_);
+  stats.budget_bytes = static_cast<std::int64_t>(budget_bytes_);
+  return stats;
+}
+
+void AnalysisCache::EvictLocked() {
+  while (bytes_ > budget_bytes_ && !lru_.empty()) {
+    const Entry& entry = lru_.back();
+    bytes_ -= entry.bytes;
+    index_.erase(entry.key);
+    lru_.pop_back();
+    evictions_++;
+  }
+}
+
+}  // namespace worldline
@@ -0,0 +1,104 @@
+#ifndef WORLDLINE_MODEL_ANALYSIS_CACHE_H_
+#define WORLDLINE_MODEL_ANALYSIS_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "worldline/common/frame_matrix.h"
+
+namespace worldline {
+
+enum class AnalysisKind : std::int32_t {
+  kF0 = 0,
+  kSp = 1,
+  kAp = 2,
+};
+
+// Content-addressed key of an analysis result. content_hash covers every
+// input buffer the result depends on (samples, and f0/time axis for sp/ap),
+// options covers estimator kind and settings.
+struct AnalysisKey {
+  std::uint64_t content_hash;
+  std::uint64_t options;
+  std::int32_t fs;
+  AnalysisKind kind;
+  double frame_ms;
+
+  bool operator==(const AnalysisKey& other) const;
+};
+
+struct AnalysisData {
+  std::vector<double> f0;
+  std::vector<double> ts;
+  FrameMatrix frames;
+
+  std::size_t Bytes() const;
+};
+
+std::uint64_t HashBuffer(const double* data, std::size_t length,
+                         std::uint64_t seed = 0);
+
+inline std::uint64_t HashBuffer(const std::vector<double>& vec,
+                                std::uint64_t seed = 0) {
+  return HashBuffer(vec.data(), vec.size(), seed);
+}
+
+// Process-wide LRU cache of f0/sp/ap analysis results, bounded by a memory
+// budget. A budget of 0 disables caching. Thread safe.
+class AnalysisCache {
+ public:
+  struct Stats {
+    std::int64_t hits;
+    std::int64_t misses;
+    std::int64_t evictions;
+    std::int64_t entries;
+    std::int64_t bytes;
+    std::int64_t budget_bytes;
+  };
+
+  static constexpr std::size_t kDefaultBudgetBytes = 256 << 20;
+
+  static AnalysisCache& Global();
+
+  explicit AnalysisCache(std::size_t budget_bytes);
+
+  bool enabled();
+
+  std::shared_ptr<const AnalysisData> Get(const AnalysisKey& key);
+  void Put(const AnalysisKey& key, std::shared_ptr<const AnalysisData> data);
+
+  void SetBudget(std::size_t budget_bytes);
+  void Clear();
+  Stats GetStats();
+
+ private:
+  struct KeyHash {
+    std::size_t operator()(const AnalysisKey& key) const;
+  };
+  struct Entry {
+    AnalysisKey key;
+    std::shared_ptr<const AnalysisData> data;
+    std::size_t bytes;
+  };
+
+  void EvictLocked();
+
+  std::mutex mutex_;
+  std::size_t budget_bytes_;
+  std::size_t bytes_ = 0;
+  std::int64_t hits_ = 0;
+  std::int64_t misses_ = 0;
+  std::int64_t evictions_ = 0;
+  // Most recently used entries first.
+  std::list<Entry> lru_;
+  std::unordered_map<AnalysisKey, std::list<Entry>::iterator, KeyHash> index_;
+};
+
+}  // namespace worldline
+
+#endif  // WORLDLINE_MODEL_ANALYSIS_CACHE_H_
@@ -0,0 +1,76 @@
+#include "analysis_cache.h"
+
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+using worldline::AnalysisCache;
+using worldline::AnalysisData;
+using worldline::AnalysisKey;
+using worldline::AnalysisKind;
+
+std::shared_ptr<AnalysisData> MakeData(int frames, int width) {
+  auto data = std::make_shared<AnalysisData>();
+  data->f0 = std::vector<double>(frames, 100);
+  data->ts = std::vector<double>(frames, 0);
+  data->frames = worldline::FrameMatrix(frames, width, 1);
+  return data;
+}
+
+AnalysisKey MakeKey(const std::vector<double>& samples) {
+  return AnalysisKey{worldline::HashBuffer(samples), 3, 44100,
+                     AnalysisKind::kF0, 10};
+}
+
+TEST(AnalysisCacheTest, HitAndMiss) {
+  AnalysisCache cache(1 << 20);
+  std::vector<double> samples(1000, 0.5);
+  AnalysisKey key = MakeKey(samples);
+  EXPECT_EQ(cache.Get(key), nullptr);
+  cache.Put(key, MakeData(10, 16));
+  auto cached = cache.Get(key);
+  ASSERT_NE(cached, nullptr);
+  EXPECT_EQ(cached->f0.size(), 10);
+
+  samples[500] = 0.25;
+  EXPECT_EQ(cache.Get(MakeKey(samples)), nullptr);
+
+  AnalysisCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 2);
+  EXPECT_EQ(stats.entries, 1);
+}
+
+TEST(AnalysisCacheTest, EvictsLeastRecentlyUsed) {
+  auto data = MakeData(10, 64);
+  AnalysisCache cache(data->Bytes() * 2);
+  std::vector<double> a(100, 0.1);
+  std::vector<double> b(100, 0.2);
+  std::vector<double> c(100, 0.3);
+  cache.Put(MakeKey(a), MakeData(10, 64));
+  cache.Put(MakeKey(b), MakeData(10, 64));
+  EXPECT_NE(cache.Get(MakeKey(a)), nullptr);
+  cache.Put(MakeKey(c), MakeData(10, 64));
+
+  EXPECT_NE(cache.Get(MakeKey(a)), nullptr);
+  EXPECT_EQ(cache.Get(MakeKey(b)), nullptr);
+  EXPECT_NE(cache.Get(MakeKey(c)), nullptr);
+  EXPECT_EQ(cache.GetStats().evictions, 1);
+  EXPECT_LE(cache.GetStats().bytes, cache.GetStats().budget_bytes);
+}
+
+TEST(AnalysisCacheTest, ZeroBudgetDisables) {
+  AnalysisCache cache(1 << 20);
+  std::vector<double> samples(100, 0.1);
+  cache.Put(MakeKey(samples), MakeData(10, 16));
+  cache.SetBudget(0);
+  EXPECT_FALSE(cache.enabled());
+  EXPECT_EQ(cache.GetStats().entries, 0);
+  cache.Put(MakeKey(samples), MakeData(10, 16));
+  EXPECT_EQ(cache.Get(MakeKey(samples)), nullptr);
+}
+
+}  // namespace
@@ -1,74 +1,103 @@
 #include "effects.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <numeric>
+#include <unordered_map>
 #include <vector>
 
 #include "spline.h"
+#include "worldline/common/vec_utils.h"
 
 namespace worldline {
 
-static void GenderWeights(std::vector<int>& indexes,
-                          std::vector<double>& weights, int width,
-                          double ratio) {
+namespace {
+
+// Source bins and weights of each bin of a gender shifted frame.
+struct GenderTable {
+  std::vector<int> index0;
+  std::vector<int> index1;
+  std::vector<double> weights;
+};
+
+GenderTable BuildGenderTable(int width, double ratio) {
+  GenderTable table;
+  table.index0.resize(width);
+  table.index1.resize(width);
+  table.weights.resize(width);
   for (int i = 0; i < width; ++i) {
     double p = i * ratio;
     int i1 = std::clamp(static_cast<int>(std::floor(p)), 0, width - 1);
     int i2 = std::clamp(static_cast<int>(std::ceil(p)), 0, width - 1);
+    // Frames are read from bins index - 1 and index.
+    int index;
     if (i1 == i2) {
-      if (i1 == 0) {
-        indexes[i] = i1 + 1;
-        weights[i] = 1;
-      } else {
-        indexes[i] = i1;
-        weights[i] = 0;
-      }
+      index = i1 == 0 ? i1 + 1 : i1;
+      table.weights[i] = i1 == 0 ? 1 : 0;
     } else {
-      double p = i * ratio;
-      int i1 = std::clamp(static_cast<int>(std::floor(p)), 0, width - 1);
-      indexes[i] = i1;
-      weights[i] = p - std::floor(p);
+      index = i1;
+      table.weights[i] = p - std::floor(p);
     }
+    // Index 0 only happens when shifting down, and used to read before the
+    // frame. Both bins are bin 0 instead.
+    table.index0[i] = std::max(0, index - 1);
+    table.index1[i] = index;
   }
+  return table;
 }
 
-void ShiftGender(std::vector<std::vector<double>>& sp, int value) {
-  double ratio = std::pow(2, value * 0.01);
-  if (ratio == 1 || ratio <= 0) {
-    return;
-  }
-  int width = sp[0].size();
-  std::vector<int> indexes(width);
-  std::vector<double> weights(width);
-  GenderWeights(indexes, weights, width, ratio);
-  for (auto& frame : sp) {
-    std::vector<double> buffer = frame;
-    for (int i = 0; i < width; ++i) {
-      int i1 = indexes[i] - 1;
-      double t = weights[i];
-      frame[i] = buffer[i1] * (1 - t) + buffer[i1 + 1] * t;
-    }
+// Tables of every (width, value) used so far. There are at most 201 values
+// per fft size.
+std::shared_ptr<const GenderTable> GetGenderTable(int width, int value) {
+  using Tables =
+      std::unordered_map<std::int64_t, std::shared_ptr<const GenderTable>>;
+  static std::mutex* mutex = new std::mutex();
+  static Tables* tables = new Tables();
+  std::int64_t key = static_cast<std::int64_t>(width) << 32 |
+                     static_cast<std::uint32_t>(value);
+  std::lock_guard<std::mutex> lock(*mutex);
+  auto& table = (*tables)[key];
+  if (table == nullptr) {
+    table = std::make_shared<GenderTable>(
+        BuildGenderTable(width, std::pow(2, value * 0.01)));
   }
+  return table;
 }
 
-void ShiftGender(double* sp, int width, int value) {
+// Shifts each of rows frames in place, through one scratch row.
+void ShiftGenderRows(double* const* frames, int rows, int width, int value) {
   double ratio = std::pow(2, value * 0.01);
   if (ratio == 1 || ratio <= 0) {
     return;
   }
-  std::vector<int> indexes(width);
-  std::vector<double> weights(width);
-  GenderWeights(indexes, weights, width, ratio);
-  std::vector<double> temp(width);
-  std::copy(sp, sp + width, temp.begin());
-  for (int i = 0; i < width; ++i) {
-    int i1 = indexes[i] - 1;
-    double t = weights[i];
-    sp[i] = temp[i1] * (1 - t) + temp[i1 + 1] * t;
+  std::shared_ptr<const GenderTable> table = GetGenderTable(width, value);
+  thread_local std::vector<double> scratch;
+  scratch.resize(width);
+  for (int k = 0; k < rows; ++k) {
+    std::copy(frames[k], frames[k] + width, scratch.begin());
+    vec_gather_lerp(scratch.data(), table->index0.data(),
+                    table->index1.data(), table->weights.data(), width,
+                    frames[k]);
   }
 }
 
+}  // namespace
+
+void ShiftGender(FrameMatrix& sp, int value) {
+  std::vector<double*> rows = sp.RowPointers();
+  ShiftGenderRows(rows.data(), sp.rows(), sp.width(), value);
+}
+
+void ShiftGender(double* sp, int width, int value) {
+  ShiftGenderRows(&sp, 1, width, value);
+}
+
 static void Logspace(std::vector<double>& vec, int i0, int i1, double power,
                      double v0, double v1) {
   double delta = (v1 - v0) / (i1 - i0);
@@ -97,9 +126,16 @@ std::vector<double> GetTensionCoefficients1(double f0, int fs, int value,
 
 std::vector<double> GetTensionCoefficients(double f0, int fs, int value,
                                            int width) {
-  std::vector<double> envelope(width, 1);
+  std::vector<double> envelope(width);
+  GetTensionCoefficients(f0, fs, value, width, envelope.data());
+  return envelope;
+}
+
+void GetTensionCoefficients(double f0, int fs, int value, int width,
+                            double* envelope) {
   if (f0 < 50) {
-    return envelope;
+    std::fill(envelope, envelope + width, 1.0);
+    return;
   }
   double v = value * 0.01;
   double s0 = -1.5 * v;
@@ -131,11 +167,91 @@ std::vector<double> GetTensionCoefficients(double f0, int fs, int value,
   for (int i = 0; i < width; ++i) {
     envelope[i] = std::exp(spline(i));
   }
-  return envelope;
 }
 
-void AutoGain(std::vector<double>& samples, double src_max, double out_max,
-              double voiced_ratio, int volume, int peakComp) {
+namespace {
+
+struct TensionKey {
+  int fs;
+  int width;
+  int value;
+  // f0 in steps of kTensionCents above kMinF0, or -1 below it.
+  int f0_step;
+
+  bool operator==(const TensionKey& other) const {
+    return fs == other.fs && width == other.width && value == other.value &&
+           f0_step == other.f0_step;
+  }
+};
+
+struct TensionKeyHash {
+  std::size_t operator()(const TensionKey& key) const {
+    std::size_t hash = std::hash<int>()(key.fs);
+    for (int v : {key.width, key.value, key.f0_step}) {
+      hash = hash * 31 + std::hash<int>()(v);
+    }
+    return hash;
+  }
+};
+
+// Envelopes below are flat.
+constexpr double kMinF0 = 50;
+// About 8 MB at width 1025. A phrase uses few tension values, so the limit
+// is only reached by long sessions, which then start over.
+constexpr std::size_t kMaxTensionEntries = 1024;
+
+class TensionTable {
+ public:
+  static TensionTable& Global() {
+    static TensionTable* table = new TensionTable();
+    return *table;
+  }
+
+  std::shared_ptr<const std::vector<double>> Get(double f0, int fs, int value,
+                                                 int width) {
+    TensionKey key{fs, width, value, -1};
+    if (f0 >= kMinF0) {
+      key.f0_step = static_cast<int>(
+          std::round(1200 * std::log2(f0 / kMinF0) / kTensionCents));
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = entries_.find(key);
+      if (it != entries_.end()) {
+        return it->second;
+      }
+    }
+    // Computed outside of the lock. Threads racing on the same key compute
+    // the same envelope, and the first one is kept.
+    double key_f0 =
+        key.f0_step < 0
+            ? 0
+            : kMinF0 * std::pow(2, key.f0_step * kTensionCents / 1200);
+    auto envelope = std::make_shared<std::vector<double>>(width);
+    GetTensionCoefficients(key_f0, fs, value, width, envelope->data());
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entries_.size() >= kMaxTensionEntries) {
+      entries_.clear();
+    }
+    return entries_.emplace(key, std::move(envelope)).first->second;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::unordered_map<TensionKey, std::shared_ptr<const std::vector<double>>,
+                     TensionKeyHash>
+      entries_;
+};
+
+}  // namespace
+
+std::shared_ptr<const std::vector<double>> GetCachedTensionCoefficients(
+    double f0, int fs, int value, int width) {
+  return TensionTable::Global().Get(f0, fs, value, width);
+}
+
+double GetAutoGain(double src_max, double out_max, double voiced_ratio,
+                   int volume, int peakComp) {
   // weighs between max of full audio file and max of synthed section
   // based on voiced ratio of synthed section
   // to avoid overamplifying consonants.
@@ -143,9 +259,15 @@ void AutoGain(std::vector<double>& samples, double src_max, double out_max,
   double max = out_max * weight + src_max * (1.0 - weight);
   double gain = volume * 0.01;
   double auto_gain = max == 0 ? 1.0 : std::pow(0.5 / max, peakComp * 0.01);
-  if (auto_gain * gain != 1) {
+  return auto_gain * gain;
+}
+
+void AutoGain(std::vector<double>& samples, double src_max, double out_max,
+              double voiced_ratio, int volume, int peakComp) {
+  double gain = GetAutoGain(src_max, out_max, voiced_ratio, volume, peakComp);
+  if (gain != 1) {
     for (int i = 0; i < samples.size(); ++i) {
-      samples[i] = samples[i] * auto_gain * gain;
+      samples[i] = samples[i] * gain;
     }
   }
 }
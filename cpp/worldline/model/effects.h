@@ -1,13 +1,16 @@
 #ifndef WORLDLINE_MODEL_EFFECTS_H_
 #define WORLDLINE_MODEL_EFFECTS_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "worldline/common/frame_matrix.h"
+
 namespace worldline {
 
 // value range [-100, 100]
-void ShiftGender(std::vector<std::vector<double>>& sp, int value);
+void ShiftGender(FrameMatrix& sp, int value);
 
 // value range [-100, 100]
 void ShiftGender(double* sp, int width, int value);
@@ -16,6 +19,21 @@ void ShiftGender(double* sp, int width, int value);
 std::vector<double> GetTensionCoefficients(double f0, int fs, int value,
                                            int width);
 
+// Same as above, written to envelope of width doubles.
+void GetTensionCoefficients(double f0, int fs, int value, int width,
+                            double* envelope);
+
+// Same as above with f0 rounded to kTensionCents, from a process-wide table
+// shared by all threads. Envelopes are computed once per key and must not
+// be modified.
+constexpr double kTensionCents = 5;
+std::shared_ptr<const std::vector<double>> GetCachedTensionCoefficients(
+    double f0, int fs, int value, int width);
+
+// Returns the gain AutoGain applies.
+double GetAutoGain(double src_max, double out_max, double voiced_ratio,
+                   int volume, int peakComp);
+
 void AutoGain(std::vector<double>& samples, double src_max, double out_max,
               double voiced_ratio, int volume, int peakComp);
 
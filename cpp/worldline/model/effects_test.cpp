@@ -0,0 +1,104 @@
+#include "worldline/model/effects.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "worldline/common/frame_matrix.h"
+
+namespace worldline {
+namespace {
+
+constexpr int kFs = 44100;
+constexpr int kWidth = 1025;
+
+// Bin by bin version of ShiftGender.
+std::vector<double> ShiftGenderReference(const std::vector<double>& frame,
+                                         int value) {
+  double ratio = std::pow(2, value * 0.01);
+  int width = frame.size();
+  std::vector<double> result(width);
+  for (int i = 0; i < width; ++i) {
+    double p = i * ratio;
+    int i1 = std::clamp(static_cast<int>(std::floor(p)), 0, width - 1);
+    int i2 = std::clamp(static_cast<int>(std::ceil(p)), 0, width - 1);
+    int index = i1;
+    double t = p - std::floor(p);
+    if (i1 == i2) {
+      index = i1 == 0 ? 1 : i1;
+      t = i1 == 0 ? 1 : 0;
+    }
+    result[i] = frame[std::max(0, index - 1)] * (1 - t) + frame[index] * t;
+  }
+  return result;
+}
+
+TEST(ShiftGenderTest, MatchesReference) {
+  FrameMatrix sp(3, kWidth);
+  for (int i = 0; i < sp.rows(); ++i) {
+    for (int j = 0; j < kWidth; ++j) {
+      sp[i][j] = 1.0 / (1 + j * 0.01 * (i + 1));
+    }
+  }
+  for (int value : {-100, -37, 0, 25, 100}) {
+    FrameMatrix shifted = sp;
+    ShiftGender(shifted, value);
+    for (int i = 0; i < sp.rows(); ++i) {
+      std::vector<double> frame(sp[i], sp[i] + kWidth);
+      std::vector<double> expected =
+          value == 0 ? frame : ShiftGenderReference(frame, value);
+      ShiftGender(frame.data(), kWidth, value);
+      for (int j = 0; j < kWidth; ++j) {
+        ASSERT_EQ(shifted[i][j], expected[j]) << value << " " << i << " " << j;
+        ASSERT_EQ(frame[j], expected[j]) << value << " " << i << " " << j;
+      }
+    }
+  }
+}
+
+TEST(TensionTableTest, MatchesDirectEnvelopeOnTheGrid) {
+  // 100 Hz is a whole number of steps above 50 Hz.
+  auto cached = GetCachedTensionCoefficients(100, kFs, 40, kWidth);
+  std::vector<double> direct = GetTensionCoefficients(100, kFs, 40, kWidth);
+  ASSERT_EQ(cached->size(), kWidth);
+  for (int i = 0; i < kWidth; ++i) {
+    EXPECT_DOUBLE_EQ((*cached)[i], direct[i]);
+  }
+}
+
+TEST(TensionTableTest, SharesEnvelopesWithinAStep) {
+  double step = std::pow(2, kTensionCents / 1200);
+  auto a = GetCachedTensionCoefficients(220, kFs, -30, kWidth);
+  auto b = GetCachedTensionCoefficients(220 * std::pow(step, 0.2), kFs, -30,
+                                        kWidth);
+  auto c = GetCachedTensionCoefficients(220 * step, kFs, -30, kWidth);
+  auto d = GetCachedTensionCoefficients(220, kFs, -20, kWidth);
+  EXPECT_EQ(a, b);
+  EXPECT_NE(a, c);
+  EXPECT_NE(a, d);
+}
+
+TEST(TensionTableTest, IsSafeToShare) {
+  std::vector<std::thread> threads;
+  std::vector<std::shared_ptr<const std::vector<double>>> results(8);
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([t, &results] {
+      for (int i = 0; i < 200; ++i) {
+        results[t] =
+            GetCachedTensionCoefficients(150 + i * 0.5, kFs, 25, kWidth);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int t = 1; t < 8; ++t) {
+    EXPECT_EQ(*results[t], *results[0]);
+  }
+}
+
+}  // namespace
+}  // namespace worldline
@@ -0,0 +1,234 @@
+#include "feature_store.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "world/codec.h"
+#include "worldline/common/frame_matrix.h"
+
+namespace worldline {
+
+static_assert(sizeof(FeatureStoreHeader) == 48, "Unexpected header layout.");
+static_assert(sizeof(FeatureStoreEntry) == 32, "Unexpected entry layout.");
+
+constexpr char FeatureStore::kMagic[9];
+
+static std::mutex& MountMutex() {
+  static std::mutex* mutex = new std::mutex();
+  return *mutex;
+}
+
+static std::vector<std::shared_ptr<FeatureStore>>& Mounted() {
+  static auto* stores = new std::vector<std::shared_ptr<FeatureStore>>();
+  return *stores;
+}
+
+static std::uint64_t EntryBytes(const FeatureStoreHeader& header,
+                                int frames) {
+  std::uint64_t width = header.fft_size / 2 + 1;
+  return frames * (2 * sizeof(double) +
+                   (width + header.ap_width) * sizeof(float));
+}
+
+FeatureStore::FeatureStore(std::unique_ptr<MappedFile> file)
+    : file_(std::move(file)) {
+  std::memcpy(&header_, file_->data(), sizeof(header_));
+  index_ = reinterpret_cast<const FeatureStoreEntry*>(file_->data() +
+                                                      header_.index_offset);
+}
+
+std::shared_ptr<FeatureStore> FeatureStore::Open(const std::string& path) {
+  std::unique_ptr<MappedFile> file = MappedFile::Open(path);
+  if (file == nullptr || file->size() < sizeof(FeatureStoreHeader)) {
+    return nullptr;
+  }
+  FeatureStoreHeader header;
+  std::memcpy(&header, file->data(), sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(header.magic)) != 0 ||
+      header.index_offset % alignof(FeatureStoreEntry) != 0 ||
+      header.index_offset + header.entry_count * sizeof(FeatureStoreEntry) >
+          file->size()) {
+    return nullptr;
+  }
+  const auto* index = reinterpret_cast<const FeatureStoreEntry*>(
+      file->data() + header.index_offset);
+  for (std::uint32_t i = 0; i < header.entry_count; ++i) {
+    if (index[i].offset + EntryBytes(header, index[i].frames) >
+        header.index_offset) {
+      return nullptr;
+    }
+  }
+  return std::shared_ptr<FeatureStore>(new FeatureStore(std::move(file)));
+}
+
+void FeatureStore::Mount(std::shared_ptr<FeatureStore> store) {
+  std::lock_guard<std::mutex> lock(MountMutex());
+  Mounted().push_back(std::move(store));
+}
+
+void FeatureStore::UnmountAll() {
+  std::lock_guard<std::mutex> lock(MountMutex());
+  Mounted().clear();
+}
+
+std::shared_ptr<const FeatureStore> FeatureStore::FindMounted(
+    std::uint64_t sample_hash, std::size_t sample_length, int fs,
+    double frame_ms, std::uint64_t f0_key, Features* features) {
+  std::lock_guard<std::mutex> lock(MountMutex());
+  for (const auto& store : Mounted()) {
+    const FeatureStoreHeader& header = store->header();
+    if (header.fs == fs && header.frame_ms == frame_ms &&
+        header.f0_key == f0_key &&
+        store->Find(sample_hash, sample_length, features)) {
+      return store;
+    }
+  }
+  return nullptr;
+}
+
+bool FeatureStore::Find(std::uint64_t sample_hash, std::size_t sample_length,
+                        Features* features) const {
+  const FeatureStoreEntry* end = index_ + header_.entry_count;
+  const FeatureStoreEntry* entry = std::lower_bound(
+      index_, end, sample_hash,
+      [](const FeatureStoreEntry& e, std::uint64_t hash) {
+        return e.sample_hash < hash;
+      });
+  if (entry == end || entry->sample_hash != sample_hash ||
+      entry->sample_length != sample_length) {
+    return false;
+  }
+  const char* data = file_->data() + entry->offset;
+  features->frames = entry->frames;
+  features->f0 = reinterpret_cast<const double*>(data);
+  features->ts = features->f0 + entry->frames;
+  features->sp = reinterpret_cast<const float*>(features->ts + entry->frames);
+  features->coded_ap = features->sp + entry->frames * width();
+  return true;
+}
+
+void FeatureStore::ReadSp(const Features& features, int begin, int count,
+                          double gain, FrameMatrix* sp) const {
+  int width = this->width();
+  *sp = FrameMatrix(count, width);
+  for (int i = 0; i < count; ++i) {
+    const float* src = features.sp + (begin + i) * width;
+    double* dst = (*sp)[i];
+    for (int j = 0; j < width; ++j) {
+      dst[j] = src[j] * gain;
+    }
+  }
+}
+
+void FeatureStore::ReadAp(const Features& features, int begin, int count,
+                          FrameMatrix* ap) const {
+  int ap_width = header_.ap_width;
+  FrameMatrix coded(count, ap_width);
+  for (int i = 0; i < count; ++i) {
+    const float* src = features.coded_ap + (begin + i) * ap_width;
+    std::copy(src, src + ap_width, coded[i]);
+  }
+  *ap = FrameMatrix(count, width());
+  std::vector<const double*> coded_rows = coded.ConstRowPointers();
+  std::vector<double*> ap_rows = ap->RowPointers();
+  DecodeAperiodicity(coded_rows.data(), count, header_.fs, header_.fft_size,
+                     ap_rows.data());
+}
+
+FeatureStoreWriter::FeatureStoreWriter(const std::string& path, int fs,
+                                       int fft_size, double frame_ms,
+                                       std::uint64_t f0_key)
+    : path_(path), temp_path_(path + ".tmp") {
+  std::memset(&header_, 0, sizeof(header_));
+  std::memcpy(header_.magic, FeatureStore::kMagic, sizeof(header_.magic));
+  header_.fs = fs;
+  header_.fft_size = fft_size;
+  header_.frame_ms = frame_ms;
+  header_.f0_key = f0_key;
+  header_.ap_width = GetNumberOfAperiodicities(fs);
+  out_.open(temp_path_, std::ios::binary | std::ios::trunc);
+  out_.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+  offset_ = sizeof(header_);
+  ok_ = out_.good();
+}
+
+template <typename T>
+static void WriteAll(std::ofstream& out, const std::vector<T>& values) {
+  out.write(reinterpret_cast<const char*>(values.data()),
+            values.size() * sizeof(T));
+}
+
+void FeatureStoreWriter::Add(std::uint64_t sample_hash,
+                             std::size_t sample_length,
+                             const std::vector<double>& f0,
+                             const std::vector<double>& ts,
+                             const FrameMatrix& sp, const FrameMatrix& ap) {
+  int frames = f0.size();
+  int width = header_.fft_size / 2 + 1;
+  int ap_width = header_.ap_width;
+  std::vector<float> sp_data;
+  sp_data.reserve(frames * width);
+  for (int i = 0; i < frames; ++i) {
+    sp_data.insert(sp_data.end(), sp[i], sp[i] + width);
+  }
+  FrameMatrix coded(frames, ap_width);
+  std::vector<const double*> ap_rows = ap.ConstRowPointers();
+  std::vector<double*> coded_rows = coded.RowPointers();
+  CodeAperiodicity(ap_rows.data(), frames, header_.fs, header_.fft_size,
+                   coded_rows.data());
+  std::vector<float> ap_data;
+  ap_data.reserve(frames * ap_width);
+  for (int i = 0; i < frames; ++i) {
+    ap_data.insert(ap_data.end(), coded[i], coded[i] + ap_width);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  FeatureStoreEntry entry;
+  entry.sample_hash = sample_hash;
+  entry.sample_length = sample_length;
+  entry.offset = offset_;
+  entry.frames = frames;
+  entry.reserved = 0;
+  WriteAll(out_, f0);
+  WriteAll(out_, ts);
+  WriteAll(out_, sp_data);
+  WriteAll(out_, ap_data);
+  // Keeps the next block 8-byte aligned.
+  std::uint64_t bytes = EntryBytes(header_, frames);
+  std::uint64_t padded = (bytes + 7) / 8 * 8;
+  for (std::uint64_t i = bytes; i < padded; ++i) {
+    out_.put(0);
+  }
+  offset_ += padded;
+  entries_.push_back(entry);
+  ok_ = ok_ && out_.good();
+}
+
+bool FeatureStoreWriter::Finish() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::sort(entries_.begin(), entries_.end(),
+            [](const FeatureStoreEntry& a, const FeatureStoreEntry& b) {
+              return a.sample_hash < b.sample_hash;
+            });
+  header_.entry_count = entries_.size();
+  header_.index_offset = offset_;
+  WriteAll(out_, entries_);
+  out_.seekp(0);
+  out_.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+  out_.close();
+  ok_ = ok_ && !out_.fail();
+  if (!ok_) {
+    std::remove(temp_path_.c_str());
+    return false;
+  }
+  std::remove(path_.c_str());
+  return std::rename(temp_path_.c_str(), path_.c_str()) == 0;
+}
+
+}  // namespace worldline
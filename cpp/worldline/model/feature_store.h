@@ -0,0 +1,119 @@
+#ifndef WORLDLINE_MODEL_FEATURE_STORE_H_
+#define WORLDLINE_MODEL_FEATURE_STORE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "worldline/common/frame_matrix.h"
+#include "worldline/common/mapped_file.h"
+
+namespace worldline {
+
+// Default name of the store in a voicebank directory.
+constexpr char kFeatureStoreFileName[] = "worldline.features";
+
+// On-disk store of pre-analyzed f0/sp/ap, keyed by the hash of the whole
+// sample buffer. File layout:
+//   FeatureStoreHeader
+//   per sample: double f0[frames], double ts[frames],
+//               float sp[frames][fft_size / 2 + 1],
+//               float coded_ap[frames][ap_width]
+//   FeatureStoreEntry[entry_count], sorted by sample_hash
+// Aperiodicity is stored band-coded (see CodeAperiodicity), as D4C itself
+// only estimates it at these bands.
+struct FeatureStoreHeader {
+  char magic[8];
+  std::int32_t fs;
+  std::int32_t fft_size;
+  double frame_ms;
+  std::uint64_t f0_key;
+  std::int32_t ap_width;
+  std::uint32_t entry_count;
+  std::uint64_t index_offset;
+};
+
+struct FeatureStoreEntry {
+  std::uint64_t sample_hash;
+  std::uint64_t sample_length;
+  std::uint64_t offset;
+  std::int32_t frames;
+  std::int32_t reserved;
+};
+
+class FeatureStore {
+ public:
+  struct Features {
+    int frames;
+    const double* f0;
+    const double* ts;
+    const float* sp;
+    const float* coded_ap;
+  };
+
+  static constexpr char kMagic[9] = "WLFEAT01";
+
+  // Returns nullptr if the file is missing or malformed.
+  static std::shared_ptr<FeatureStore> Open(const std::string& path);
+
+  // Makes a store visible to Model. Stores are searched in mount order.
+  static void Mount(std::shared_ptr<FeatureStore> store);
+  static void UnmountAll();
+  static std::shared_ptr<const FeatureStore> FindMounted(
+      std::uint64_t sample_hash, std::size_t sample_length, int fs,
+      double frame_ms, std::uint64_t f0_key, Features* features);
+
+  const FeatureStoreHeader& header() const { return header_; }
+  int width() const { return header_.fft_size / 2 + 1; }
+
+  bool Find(std::uint64_t sample_hash, std::size_t sample_length,
+            Features* features) const;
+
+  // Copies frames [begin, begin + count) of sp scaled by gain into rows.
+  void ReadSp(const Features& features, int begin, int count, double gain,
+              FrameMatrix* sp) const;
+  // Decodes frames [begin, begin + count) of ap into rows.
+  void ReadAp(const Features& features, int begin, int count,
+              FrameMatrix* ap) const;
+
+ private:
+  explicit FeatureStore(std::unique_ptr<MappedFile> file);
+
+  std::unique_ptr<MappedFile> file_;
+  FeatureStoreHeader header_;
+  const FeatureStoreEntry* index_;
+};
+
+// Writes a feature store. Add() may be called from multiple threads. The
+// file is written to a temporary path and renamed on Finish().
+class FeatureStoreWriter {
+ public:
+  FeatureStoreWriter(const std::string& path, int fs, int fft_size,
+                     double frame_ms, std::uint64_t f0_key);
+
+  bool ok() const { return ok_; }
+
+  void Add(std::uint64_t sample_hash, std::size_t sample_length,
+           const std::vector<double>& f0, const std::vector<double>& ts,
+           const FrameMatrix& sp, const FrameMatrix& ap);
+
+  bool Finish();
+
+ private:
+  std::string path_;
+  std::string temp_path_;
+  std::ofstream out_;
+  FeatureStoreHeader header_;
+  std::vector<FeatureStoreEntry> entries_;
+  std::uint64_t offset_;
+  bool ok_;
+  std::mutex mutex_;
+};
+
+}  // namespace worldline
+
+#endif  // WORLDLINE_MODEL_FEATURE_STORE_H_
@@ -0,0 +1,128 @@
+#include "worldline/model/feature_store.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "world/codec.h"
+
+namespace worldline {
+namespace {
+
+constexpr int kFs = 44100;
+constexpr int kFftSize = 2048;
+constexpr int kWidth = kFftSize / 2 + 1;
+
+FrameMatrix Frames(int frames, double base) {
+  FrameMatrix result(frames, kWidth);
+  for (int i = 0; i < frames; ++i) {
+    for (int j = 0; j < kWidth; ++j) {
+      result[i][j] = base + 0.25 * (i + 1) / (j + 1);
+    }
+  }
+  return result;
+}
+
+class FeatureStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = ::testing::TempDir() + "feature_store_test.features";
+    f0_ = {0, 220, 221, 222};
+    ts_ = {0, 0.01, 0.02, 0.03};
+    sp_ = Frames(4, 1e-3);
+    ap_ = Frames(4, 0.1);
+    FeatureStoreWriter writer(path_, kFs, kFftSize, 10, 3);
+    ASSERT_TRUE(writer.ok());
+    writer.Add(42, 1000, f0_, ts_, sp_, ap_);
+    writer.Add(7, 10, {100}, {0}, Frames(1, 0), Frames(1, 0.5));
+    ASSERT_TRUE(writer.Finish());
+  }
+
+  void TearDown() override { std::remove(path_.c_str()); }
+
+  std::string path_;
+  std::vector<double> f0_;
+  std::vector<double> ts_;
+  FrameMatrix sp_;
+  FrameMatrix ap_;
+};
+
+TEST_F(FeatureStoreTest, ReadsBackFeatures) {
+  auto store = FeatureStore::Open(path_);
+  ASSERT_NE(store, nullptr);
+  EXPECT_EQ(store->header().entry_count, 2);
+
+  FeatureStore::Features features;
+  ASSERT_TRUE(store->Find(42, 1000, &features));
+  ASSERT_EQ(features.frames, 4);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(features.f0[i], f0_[i]);
+    EXPECT_EQ(features.ts[i], ts_[i]);
+  }
+
+  FrameMatrix sp;
+  store->ReadSp(features, 1, 2, 2.0, &sp);
+  ASSERT_EQ(sp.rows(), 2);
+  for (int j = 0; j < kWidth; ++j) {
+    EXPECT_FLOAT_EQ(sp[0][j], sp_[1][j] * 2.0);
+    EXPECT_FLOAT_EQ(sp[1][j], sp_[2][j] * 2.0);
+  }
+
+  // Aperiodicity goes through the band codec.
+  FrameMatrix coded(4, GetNumberOfAperiodicities(kFs));
+  FrameMatrix expected(4, kWidth);
+  std::vector<const double*> ap_rows = ap_.ConstRowPointers();
+  std::vector<double*> coded_rows = coded.RowPointers();
+  CodeAperiodicity(ap_rows.data(), 4, kFs, kFftSize, coded_rows.data());
+  std::vector<const double*> coded_const_rows = coded.ConstRowPointers();
+  std::vector<double*> expected_rows = expected.RowPointers();
+  DecodeAperiodicity(coded_const_rows.data(), 4, kFs, kFftSize,
+                     expected_rows.data());
+  FrameMatrix ap;
+  store->ReadAp(features, 0, 4, &ap);
+  ASSERT_EQ(ap.rows(), 4);
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < kWidth; ++j) {
+      EXPECT_NEAR(ap[i][j], expected[i][j], 1e-5);
+    }
+  }
+}
+
+TEST_F(FeatureStoreTest, MissesUnknownSamples) {
+  auto store = FeatureStore::Open(path_);
+  ASSERT_NE(store, nullptr);
+  FeatureStore::Features features;
+  EXPECT_TRUE(store->Find(7, 10, &features));
+  EXPECT_FALSE(store->Find(7, 11, &features));
+  EXPECT_FALSE(store->Find(8, 10, &features));
+}
+
+TEST_F(FeatureStoreTest, FindsMountedStoreWithMatchingConfig) {
+  FeatureStore::Mount(FeatureStore::Open(path_));
+  FeatureStore::Features features;
+  EXPECT_NE(FeatureStore::FindMounted(42, 1000, kFs, 10, 3, &features),
+            nullptr);
+  EXPECT_EQ(FeatureStore::FindMounted(42, 1000, 48000, 10, 3, &features),
+            nullptr);
+  EXPECT_EQ(FeatureStore::FindMounted(42, 1000, kFs, 10, 1, &features),
+            nullptr);
+  FeatureStore::UnmountAll();
+  EXPECT_EQ(FeatureStore::FindMounted(42, 1000, kFs, 10, 3, &features),
+            nullptr);
+}
+
+TEST(FeatureStoreOpenTest, RejectsMissingAndMalformedFiles) {
+  EXPECT_EQ(FeatureStore::Open(::testing::TempDir() + "missing.features"),
+            nullptr);
+  std::string path = ::testing::TempDir() + "malformed.features";
+  std::FILE* file = std::fopen(path.c_str(), "wb");
+  std::fputs("not a feature store, but long enough to hold a header", file);
+  std::fclose(file);
+  EXPECT_EQ(FeatureStore::Open(path), nullptr);
+  std::remove(path.c_str());
+}
+
+}  // namespace
+}  // namespace worldline
@@ -1,103 +1,422 @@
 #include "model.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iterator>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "world/cheaptrick.h"
 #include "world/constantnumbers.h"
 #include "world/d4c.h"
 #include "world/dio.h"
 #include "world/synthesis.h"
+#include "worldline/classic/frq.h"
+#include "worldline/common/thread_pool.h"
 #include "worldline/common/vec_utils.h"
+#include "worldline/f0/dio_estimator.h"
+#include "worldline/f0/frq_estimator.h"
+#include "worldline/f0/pyin_estimator.h"
+#include "worldline/model/analysis_cache.h"
+#include "worldline/model/feature_store.h"
 #include "worldline/platinum/platinum.h"
 #include "worldline/platinum/synthesisplatinum.h"
+#include "worldline/world_mt/cheaptrick_mt.h"
+#include "worldline/world_mt/d4c_mt.h"
+#include "worldline/world_mt/synthesis_mt.h"
 
 namespace worldline {
 
+// Lowest f0 covered by the sp window at preview quality, which halves the
+// default fft_size.
+const double kPreviewF0Floor = 2 * world::kFloorF0;
+
+static std::atomic<PyinMethod> pyin_method{PyinMethod::kLibpyin};
+
+void SetPyinMethod(PyinMethod method) { pyin_method = method; }
+
+std::unique_ptr<F0Estimator> MakeF0Estimator(std::string_view frq_data,
+                                             QualityTier quality,
+                                             int sample_tone) {
+  if (!frq_data.empty()) {
+    return std::make_unique<FrqEstimator>(frq_data);
+  }
+  if (quality == QualityTier::kPreview) {
+    return std::make_unique<DioEstimator>();
+  }
+  double expected_f0 =
+      sample_tone > 0 ? 440.0 * std::pow(2.0, (sample_tone - 69) / 12.0) : 0;
+  return std::make_unique<PyinEstimator>(expected_f0, pyin_method.load());
+}
+
+// Mutex of the write-backs of path in progress.
+static std::shared_ptr<std::mutex> WriteBackMutex(
+    const std::filesystem::path& path) {
+  static std::mutex mutex;
+  static auto* mutexes =
+      new std::map<std::filesystem::path, std::weak_ptr<std::mutex>>();
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto it = mutexes->begin(); it != mutexes->end();) {
+    it = it->second.expired() ? mutexes->erase(it) : std::next(it);
+  }
+  std::weak_ptr<std::mutex>& entry = (*mutexes)[path];
+  std::shared_ptr<std::mutex> path_mutex = entry.lock();
+  if (path_mutex == nullptr) {
+    path_mutex = std::make_shared<std::mutex>();
+    entry = path_mutex;
+  }
+  return path_mutex;
+}
+
+std::string WriteBackFrq(const std::vector<double>& samples, int fs,
+                         int sample_tone,
+                         const std::filesystem::path& frq_path) {
+  std::shared_ptr<std::mutex> path_mutex = WriteBackMutex(frq_path);
+  std::lock_guard<std::mutex> lock(*path_mutex);
+  // Written by an earlier call meanwhile.
+  std::string written = ReadFrqFile(frq_path);
+  if (!written.empty()) {
+    return written;
+  }
+  std::unique_ptr<F0Estimator> estimator =
+      MakeF0Estimator({}, QualityTier::kFinal, sample_tone);
+  std::string data = DumpFrq(EstimateFrq(samples, fs, estimator.get()));
+  WriteFrqFile(frq_path, data);
+  return data;
+}
+
 Model::Model(std::vector<double> samples, int fs, double frame_ms,
              std::unique_ptr<F0Estimator> f0_estimator)
     : samples_(std::move(samples)),
       fs_(fs),
       frame_ms_(frame_ms),
       f0_estimator_(std::move(f0_estimator)) {}
+Model::Model(std::shared_ptr<const std::vector<double>> samples, int fs,
+             double frame_ms, std::unique_ptr<F0Estimator> f0_estimator)
+    : borrowed_(std::move(samples)),
+      fs_(fs),
+      frame_ms_(frame_ms),
+      f0_estimator_(std::move(f0_estimator)) {
+  borrowed_range_ = absl::MakeConstSpan(*borrowed_);
+}
 Model::Model(int fs, double frame_ms, int fft_size)
     : fs_(fs), frame_ms_(frame_ms), fft_size_(fft_size) {}
 
+// Extra audio analyzed on both sides of a region, so that f0 tracking settles
+// before the frames that are kept.
+constexpr double kF0MarginMs = 250;
+
+// Key of sp/ap results, which depend on samples, f0 and time axis.
+static AnalysisKey FramesKey(absl::Span<const double> samples,
+                             const std::vector<double>& f0,
+                             const std::vector<double>& ts, int fs,
+                             double frame_ms, AnalysisKind kind,
+                             std::uint64_t options) {
+  std::uint64_t hash = HashBuffer(samples.data(), samples.size());
+  hash = HashBuffer(f0, hash);
+  hash = HashBuffer(ts, hash);
+  return AnalysisKey{hash, options, fs, kind, frame_ms};
+}
+
 void Model::BuildF0() {
-  f0_estimator_->Estimate(samples_, fs_, frame_ms_, &f0_, &ts_);
+  std::uint64_t hash = 0;
+  if (f0_estimator_->CacheKey() != 0) {
+    hash = HashBuffer(samples().data(), samples().size());
+    if (LoadStoredF0(hash)) {
+      return;
+    }
+  }
+  EstimateF0(SampleVector(), hash, &f0_, &ts_);
+}
+
+void Model::BuildF0(int start, int length) {
+  if (!f0_estimator_->SupportsRegion()) {
+    BuildF0();
+    return;
+  }
+  absl::Span<const double> samples = this->samples();
+  if (f0_estimator_->CacheKey() != 0 &&
+      LoadStoredF0(HashBuffer(samples.data(), samples.size()))) {
+    return;
+  }
+  int margin = static_cast<int>(std::ceil(kF0MarginMs / frame_ms_));
+  int first = std::max(0, start - margin);
+  int first_sample = MsToSamples(first * frame_ms_);
+  int last_sample =
+      std::min(static_cast<int>(samples.size()),
+               MsToSamples((start + length + margin) * frame_ms_));
+  if (first_sample >= last_sample) {
+    BuildF0();
+    return;
+  }
+  std::vector<double> region(samples.begin() + first_sample,
+                             samples.begin() + last_sample);
+  std::uint64_t hash = f0_estimator_->CacheKey() != 0 ? HashBuffer(region) : 0;
+  std::vector<double> f0;
+  std::vector<double> ts;
+  EstimateF0(region, hash, &f0, &ts);
+
+  // Lays the region out on the frames of the whole file. Frames outside of
+  // it are never used and left unvoiced.
+  int frames = std::max(first + static_cast<int>(f0.size()), start + length);
+  double t0 = static_cast<double>(first_sample) / fs_;
+  f0_.assign(frames, 0);
+  ts_.resize(frames);
+  std::copy(f0.begin(), f0.end(), f0_.begin() + first);
+  for (int i = 0; i < frames; ++i) {
+    int k = i - first;
+    ts_[i] = k >= 0 && k < ts.size() ? ts[k] + t0 : i * frame_ms_ / 1000.0;
+  }
+}
+
+bool Model::LoadStoredF0(std::uint64_t hash) {
+  store_ = FeatureStore::FindMounted(hash, samples().size(), fs_, frame_ms_,
+                                    f0_estimator_->CacheKey(), &stored_);
+  if (store_ == nullptr) {
+    return false;
+  }
+  f0_.assign(stored_.f0, stored_.f0 + stored_.frames);
+  ts_.assign(stored_.ts, stored_.ts + stored_.frames);
+  store_offset_ = 0;
+  return true;
+}
+
+void Model::EstimateF0(const std::vector<double>& samples, std::uint64_t hash,
+                       std::vector<double>* f0, std::vector<double>* ts) {
+  AnalysisCache& cache = AnalysisCache::Global();
+  std::uint64_t estimator_key = f0_estimator_->CacheKey();
+  if (estimator_key == 0 || !cache.enabled()) {
+    f0_estimator_->Estimate(samples, fs_, frame_ms_, f0, ts);
+    return;
+  }
+  AnalysisKey key{hash, estimator_key, fs_, AnalysisKind::kF0, frame_ms_};
+  if (auto cached = cache.Get(key)) {
+    *f0 = cached->f0;
+    *ts = cached->ts;
+    return;
+  }
+  f0_estimator_->Estimate(samples, fs_, frame_ms_, f0, ts);
+  auto data = std::make_shared<AnalysisData>();
+  data->f0 = *f0;
+  data->ts = *ts;
+  cache.Put(key, std::move(data));
+}
+
+const std::vector<double>& Model::SampleVector() {
+  if (borrowed_ != nullptr && borrowed_range_.size() == borrowed_->size()) {
+    return *borrowed_;
+  }
+  return mutable_samples();
+}
+
+std::vector<double>& Model::mutable_samples() {
+  if (borrowed_ != nullptr) {
+    samples_.assign(borrowed_range_.begin(), borrowed_range_.end());
+    borrowed_ = nullptr;
+    borrowed_range_ = {};
+  }
+  return samples_;
 }
 
 void Model::BuildSp() {
   CheapTrickOption ct_option;
   InitializeCheapTrickOption(fs_, &ct_option);
+  if (quality_ == QualityTier::kPreview) {
+    ct_option.f0_floor = kPreviewF0Floor;
+    ct_option.fft_size = GetFFTSizeForCheapTrick(fs_, &ct_option);
+  }
   fft_size_ = ct_option.fft_size;
-  sp_ = vec2d(fft_size_ / 2 + 1, f0_.size(), 0);
-  std::vector<double*> sp_wrapper = vec2d_wrapper(sp_);
-  CheapTrick(samples_.data(), samples_.size(), fs_, ts_.data(), f0_.data(),
-             f0_.size(), &ct_option, sp_wrapper.data());
+  if (store_ != nullptr && store_->header().fft_size == fft_size_) {
+    store_->ReadSp(stored_, store_offset_, f0_.size(), gain_ * gain_, &sp_);
+    return;
+  }
+  AnalysisCache& cache = AnalysisCache::Global();
+  bool use_cache = cache.enabled();
+  AnalysisKey key;
+  if (use_cache) {
+    key = FramesKey(samples(), f0_, ts_, fs_, frame_ms_, AnalysisKind::kSp,
+                    OptionsKey());
+    if (auto cached = cache.Get(key)) {
+      sp_ = cached->frames;
+      return;
+    }
+  }
+  sp_ = FrameMatrix(f0_.size(), fft_size_ / 2 + 1);
+  std::vector<double*> sp_rows = sp_.RowPointers();
+  CheapTrickMt(samples().data(), samples().size(), fs_, ts_.data(), f0_.data(),
+               f0_.size(), &ct_option, sp_rows.data(), &ThreadPool::Global());
+  if (use_cache && cache_frames_) {
+    auto data = std::make_shared<AnalysisData>();
+    data->frames = sp_;
+    cache.Put(key, std::move(data));
+  }
 }
 
 void Model::BuildAp() {
   D4COption d4c_option;
   InitializeD4COption(&d4c_option);
   d4c_option.threshold = 0;
-  ap_ = vec2d(fft_size_ / 2 + 1, f0_.size(), 0);
-  std::vector<double*> ap_wrapper = vec2d_wrapper(ap_);
-  D4C(samples_.data(), samples_.size(), fs_, ts_.data(), f0_.data(), f0_.size(),
-      fft_size_, &d4c_option, ap_wrapper.data());
+  if (store_ != nullptr && store_->header().fft_size == fft_size_) {
+    store_->ReadAp(stored_, store_offset_, f0_.size(), &ap_);
+    return;
+  }
+  AnalysisCache& cache = AnalysisCache::Global();
+  bool use_cache = cache.enabled();
+  AnalysisKey key;
+  if (use_cache) {
+    key = FramesKey(samples(), f0_, ts_, fs_, frame_ms_, AnalysisKind::kAp,
+                    OptionsKey());
+    if (auto cached = cache.Get(key)) {
+      ap_ = cached->frames;
+      return;
+    }
+  }
+  if (quality_ == QualityTier::kPreview) {
+    BuildDecimatedAp(d4c_option, kPreviewApStep);
+  } else {
+    ap_ = FrameMatrix(f0_.size(), fft_size_ / 2 + 1);
+    std::vector<double*> ap_rows = ap_.RowPointers();
+    D4CMt(samples().data(), samples().size(), fs_, ts_.data(), f0_.data(),
+          f0_.size(), fft_size_, &d4c_option, ap_rows.data(),
+          &ThreadPool::Global());
+  }
+  if (use_cache && cache_frames_) {
+    auto data = std::make_shared<AnalysisData>();
+    data->frames = ap_;
+    cache.Put(key, std::move(data));
+  }
+}
+
+void Model::BuildDecimatedAp(const D4COption& d4c_option, int step) {
+  int frames = f0_.size();
+  int width = fft_size_ / 2 + 1;
+  ap_ = FrameMatrix::Uninitialized(frames, width);
+  if (frames == 0) {
+    return;
+  }
+  // Analyzed frames are every step-th one and the last one.
+  int analyzed = (frames + step - 2) / step + 1;
+  std::vector<double> f0(analyzed);
+  std::vector<double> ts(analyzed);
+  for (int k = 0; k < analyzed; ++k) {
+    int i = std::min(k * step, frames - 1);
+    f0[k] = f0_[i];
+    ts[k] = ts_[i];
+  }
+  FrameMatrix coarse(analyzed, width);
+  std::vector<double*> coarse_rows = coarse.RowPointers();
+  D4CMt(samples().data(), samples().size(), fs_, ts.data(), f0.data(), analyzed,
+        fft_size_, &d4c_option, coarse_rows.data(), &ThreadPool::Global());
+  for (int i = 0; i < frames; ++i) {
+    int k = std::min(i / step, analyzed - 1);
+    int i0 = std::min(k * step, frames - 1);
+    if (i == i0 || k + 1 == analyzed) {
+      std::copy(coarse[k], coarse[k] + width, ap_[i]);
+      continue;
+    }
+    int i1 = std::min(i0 + step, frames - 1);
+    vec_lerp(coarse[k], coarse[k + 1], static_cast<double>(i - i0) / (i1 - i0),
+             width, ap_[i]);
+  }
+}
+
+std::uint64_t Model::OptionsKey() const {
+  return static_cast<std::uint64_t>(fft_size_) |
+         static_cast<std::uint64_t>(quality_) << 32;
 }
 
 void Model::BuildResidual() {
-  std::vector<double*> sp_wrapper = vec2d_wrapper(sp_);
-  residual_ = vec2d(fft_size_, f0_.size(), 0);
-  std::vector<double*> residual_wrapper = vec2d_wrapper(residual_);
-  Platinum(samples_.data(), samples_.size(), fs_, ts_.data(), f0_.data(),
-           f0_.size(), sp_wrapper.data(), fft_size_, residual_wrapper.data());
+  std::vector<double*> sp_rows = sp_.RowPointers();
+  residual_ = FrameMatrix(f0_.size(), fft_size_);
+  std::vector<double*> residual_rows = residual_.RowPointers();
+  std::vector<double>& samples = mutable_samples();
+  Platinum(samples.data(), samples.size(), fs_, ts_.data(), f0_.data(),
+           f0_.size(), sp_rows.data(), fft_size_, residual_rows.data());
 }
 
-void Model::SynthParams(std::vector<std::vector<double>>* tension,
+void Model::SynthParams(std::vector<double>* tension,
                         std::vector<double>* breathiness,
                         std::vector<double>* voicing) {
-  *tension = vec2d(sp_[0].size(), f0_.size(), 1);
+  *tension = std::vector<double>(f0_.size(), 0);
   *breathiness = std::vector<double>(f0_.size(), 1);
   *voicing = std::vector<double>(f0_.size(), 1);
 }
 
-void Model::Synth(std::vector<std::vector<double>>& tension,
-                  std::vector<double>& breathiness,
-                  std::vector<double>& voicing) {
-  int y_len = static_cast<int>(fs_ * (f0_.size() - 1) * frame_ms_ / 1000.0) + 1;
+void Model::Synth(const std::vector<double>& tension,
+                  const std::vector<double>& tension_f0,
+                  const std::vector<double>& breathiness,
+                  const std::vector<double>& voicing) {
+  int y_len = SynthLength();
   std::vector<double> y = std::vector<double>(y_len);
-  std::vector<double*> sp_wrapper = vec2d_wrapper(sp_);
-  std::vector<double*> ap_wrapper = vec2d_wrapper(ap_);
-  std::vector<double*> tension_wrapper = vec2d_wrapper(tension);
-  Synthesis(f0_.data(), f0_.size(), sp_wrapper.data(), ap_wrapper.data(),
-            fft_size_, frame_ms_, fs_, tension_wrapper.data(),
-            breathiness.data(), voicing.data(), y_len, y.data());
+  std::vector<double*> sp_rows = sp_.RowPointers();
+  std::vector<double*> ap_rows = ap_.RowPointers();
+  SynthesisMt(f0_.data(), f0_.size(), sp_rows.data(), ap_rows.data(),
+              fft_size_, frame_ms_, fs_, tension.data(), tension_f0.data(),
+              breathiness.data(), voicing.data(), y_len, y.data(),
+              &ThreadPool::Global());
   samples_ = std::move(y);
+  borrowed_ = nullptr;
+  borrowed_range_ = {};
+}
+
+std::unique_ptr<SynthesisStream> Model::SynthStream(
+    const std::vector<double>& tension, const std::vector<double>& tension_f0,
+    const std::vector<double>& breathiness,
+    const std::vector<double>& voicing) {
+  std::vector<double*> sp_rows = sp_.RowPointers();
+  std::vector<double*> ap_rows = ap_.RowPointers();
+  return std::make_unique<SynthesisStream>(
+      f0_.data(), f0_.size(), sp_rows.data(), ap_rows.data(), fft_size_,
+      frame_ms_, fs_, tension.data(), tension_f0.data(), breathiness.data(),
+      voicing.data(), SynthLength(), &ThreadPool::Global());
 }
 
 void Model::SynthPlatinum() {
-  int y_len = static_cast<int>(fs_ * (f0_.size() - 1) * frame_ms_ / 1000.0) + 1;
+  int y_len = SynthLength();
   std::vector<double> y = std::vector<double>(y_len);
-  std::vector<double*> sp_wrapper = vec2d_wrapper(sp_);
-  std::vector<double*> residual_wrapper = vec2d_wrapper(residual_);
-  SynthesisPlatinum(f0_.data(), f0_.size(), sp_wrapper.data(),
-                    residual_wrapper.data(), fft_size_, frame_ms_, fs_, y_len,
+  std::vector<double*> sp_rows = sp_.RowPointers();
+  std::vector<double*> residual_rows = residual_.RowPointers();
+  SynthesisPlatinum(f0_.data(), f0_.size(), sp_rows.data(),
+                    residual_rows.data(), fft_size_, frame_ms_, fs_, y_len,
                     y.data());
 
   samples_ = std::move(y);
+  borrowed_ = nullptr;
+  borrowed_range_ = {};
+}
+
+void Model::Scale(double gain) {
+  if (gain == 1) {
+    return;
+  }
+  for (double& sample : mutable_samples()) {
+    sample *= gain;
+  }
+  gain_ *= gain;
 }
 
 void Model::Trim(int start, int length) {
   int start_samples = static_cast<int>(frame_ms_ * start * fs_ / 1000.0);
   int length_samples = static_cast<int>(frame_ms_ * length * fs_ / 1000.0);
-  samples_.erase(samples_.begin(), samples_.begin() + start_samples);
-  samples_.erase(samples_.begin() + length_samples, samples_.end());
+  if (borrowed_ != nullptr) {
+    borrowed_range_ = borrowed_range_.subspan(start_samples, length_samples);
+  } else {
+    samples_.erase(samples_.begin(), samples_.begin() + start_samples);
+    samples_.erase(samples_.begin() + length_samples, samples_.end());
+  }
   if (f0_.size() > 0) {
     f0_.erase(f0_.begin(), f0_.begin() + start);
     f0_.erase(f0_.begin() + length, f0_.end());
   }
+  store_offset_ += start;
   if (ts_.size() > 0) {
     ts_.erase(ts_.begin(), ts_.begin() + start);
     ts_.erase(ts_.begin() + length, ts_.end());
@@ -106,41 +425,88 @@ void Model::Trim(int start, int length) {
   for (int i = 0; i < ts_.size(); ++i) {
     ts_.data()[i] -= t0;
   }
-  if (sp_.size() > 0) {
-    sp_.erase(sp_.begin(), sp_.begin() + start);
-    sp_.erase(sp_.begin() + length, sp_.end());
+  if (!sp_.empty()) {
+    sp_.Trim(start, length);
   }
-  if (ap_.size() > 0) {
-    ap_.erase(ap_.begin(), ap_.begin() + start);
-    ap_.erase(ap_.begin() + length, ap_.end());
+  if (!ap_.empty()) {
+    ap_.Trim(start, length);
   }
-  if (residual_.size() > 0) {
-    residual_.erase(residual_.begin(), residual_.begin() + start);
-    residual_.erase(residual_.begin() + length, residual_.end());
+  if (!residual_.empty()) {
+    residual_.Trim(start, length);
   }
 }
 
+// Whether mapping keeps the frames as they are, apart from edges repeated
+// by PadTimeMapping: lead copies of frame 0, frames [0, length) in place, then
+// copies of the last of them.
+static bool IsPaddedIdentity(const std::vector<double>& mapping,
+                             double frame_ms, int frames, int* lead,
+                             int* length) {
+  int k = 0;
+  while (k < mapping.size() && mapping[k] == 0) {
+    k++;
+  }
+  if (k == 0 || frames == 0) {
+    return false;
+  }
+  *lead = k - 1;
+  for (k = *lead; k < mapping.size() && k - *lead < frames; ++k) {
+    if (mapping[k] / frame_ms != k - *lead) {
+      break;
+    }
+  }
+  *length = k - *lead;
+  for (; k < mapping.size(); ++k) {
+    if (mapping[k] != mapping[*lead + *length - 1]) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void Model::Remap(const std::vector<double>& mapping) {
+  int lead;
+  int length;
+  if (IsPaddedIdentity(mapping, frame_ms_, f0_.size(), &lead, &length)) {
+    // Frames stay as they are, the tail is dropped and the edges repeated.
+    // No frame is lerped, and sp and ap are only moved if padded in front.
+    int trail = mapping.size() - lead - length;
+    f0_.resize(length);
+    f0_.insert(f0_.begin(), lead, f0_.front());
+    f0_.insert(f0_.end(), trail, f0_.back());
+    for (FrameMatrix* frames : {&sp_, &ap_, &residual_}) {
+      if (!frames->empty()) {
+        frames->Trim(0, length);
+        frames->Pad(lead, trail);
+      }
+    }
+    if (lead > 0) {
+      store_ = nullptr;
+    }
+    return;
+  }
   std::vector<double> new_f0;
-  std::vector<std::vector<double>> new_sp;
-  std::vector<std::vector<double>> new_other;
   new_f0.reserve(mapping.size());
-  new_sp.reserve(mapping.size());
-  new_other.reserve(mapping.size());
-  const auto& other = ap_.size() > 0 ? ap_ : residual_;
-  for (double p : mapping) {
-    double pos = p / frame_ms_;
+  const FrameMatrix& other = !ap_.empty() ? ap_ : residual_;
+  FrameMatrix new_sp = FrameMatrix::Uninitialized(mapping.size(), sp_.width());
+  FrameMatrix new_other =
+      FrameMatrix::Uninitialized(mapping.size(), other.width());
+  for (int k = 0; k < mapping.size(); ++k) {
+    double pos = mapping[k] / frame_ms_;
     int idx = static_cast<int>(pos);
     double t = pos - idx;
     int i0 = std::min(idx, (int)f0_.size() - 1);
     int i1 = std::min(idx + 1, (int)f0_.size() - 1);
     new_f0.push_back(f0_[i0] * (1.0 - t) + f0_[i1] * t);
-    new_sp.push_back(vec_lerp(sp_[i0], sp_[i1], t));
-    new_other.push_back(vec_lerp(other[i0], other[i1], t));
+    vec_lerp(sp_[i0], sp_[i1], t, sp_.width(), new_sp[k]);
+    if (!other.empty()) {
+      vec_lerp(other[i0], other[i1], t, other.width(), new_other[k]);
+    }
   }
   f0_ = std::move(new_f0);
   sp_ = std::move(new_sp);
-  if (ap_.size() > 0) {
+  store_ = nullptr;
+  if (!ap_.empty()) {
     ap_ = std::move(new_other);
   } else {
     residual_ = std::move(new_other);
@@ -156,4 +522,18 @@ double Model::GetVoicedRatio() {
 
 int Model::MsToSamples(double ms) { return static_cast<int>(ms * fs_ / 1000); }
 
+int Model::SynthLength() {
+  return static_cast<int>(fs_ * (f0_.size() - 1) * frame_ms_ / 1000.0) + 1;
+}
+
+std::size_t Model::Bytes() const {
+  std::size_t bytes = sizeof(Model);
+  bytes += (samples_.capacity() + f0_.capacity() + ts_.capacity()) *
+           sizeof(double);
+  for (const FrameMatrix* frames : {&sp_, &ap_, &residual_}) {
+    bytes += frames->rows() * frames->stride() * sizeof(double);
+  }
+  return bytes;
+}
+
 }  // namespace worldline
@@ -1,40 +1,123 @@
 #ifndef WORLDLINE_MODEL_MODEL_H_
 #define WORLDLINE_MODEL_MODEL_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
 #include <memory>
+#include <string>
+#include <string_view>
 #include <vector>
 
+#include "absl/types/span.h"
+#include "world/d4c.h"
+#include "worldline/common/frame_matrix.h"
 #include "worldline/f0/f0_estimator.h"
+#include "worldline/f0/pyin_estimator.h"
+#include "worldline/model/feature_store.h"
+#include "worldline/world_mt/synthesis_mt.h"
 
 namespace worldline {
 
+// Trade-off between analysis cost and quality. Values match
+// SynthRequest::quality.
+enum class QualityTier : int {
+  // Settings of exported renders.
+  kFinal = 0,
+  // For playback while editing: a smaller fft_size, and aperiodicity of
+  // every kPreviewApStep-th frame, lerped in between. F0 estimators are
+  // picked by the caller, see MakeF0Estimator.
+  kPreview = 1,
+};
+
+constexpr int kPreviewApStep = 4;
+
+// F0 of frq_data if given, otherwise estimated with pyin, or with DIO at
+// preview quality. pyin only searches around sample_tone, the MIDI tone the
+// samples were recorded at, unless it is 0.
+std::unique_ptr<F0Estimator> MakeF0Estimator(std::string_view frq_data,
+                                             QualityTier quality,
+                                             int sample_tone = 0);
+
+// Implementation of pyin picked by MakeF0Estimator from now on, for the whole
+// process. Defaults to PyinMethod::kLibpyin.
+void SetPyinMethod(PyinMethod method);
+
+// Estimates f0 of the whole samples with the final quality estimator, writes
+// it to frq_path as a frq file and returns the file content. The content is
+// returned even if it could not be written. Calls for the same frq_path, e.g.
+// of notes analyzed in parallel, run one at a time, and once the file exists
+// they return its content instead of estimating f0 again.
+std::string WriteBackFrq(const std::vector<double>& samples, int fs,
+                         int sample_tone,
+                         const std::filesystem::path& frq_path);
+
 class Model {
  public:
   Model(std::vector<double> samples, int fs, double frame_ms,
         std::unique_ptr<F0Estimator> f0_estimator);
+  // Borrows samples shared with others, e.g. by SampleStore. They are read
+  // in place, and Trim narrows the view, until Scale or BuildResidual need a
+  // private copy or synthesis replaces them.
+  Model(std::shared_ptr<const std::vector<double>> samples, int fs,
+        double frame_ms, std::unique_ptr<F0Estimator> f0_estimator);
   Model(int fs, double frame_ms, int fft_size);
 
+  // Settings of BuildSp and BuildAp. Defaults to kFinal.
+  void set_quality(QualityTier quality) { quality_ = quality; }
+  QualityTier quality() const { return quality_; }
+  // Whether BuildSp and BuildAp add what they analyze to the analysis cache.
+  // Cached results are read either way. Defaults to true.
+  void set_cache_frames(bool cache_frames) { cache_frames_ = cache_frames; }
+
   void BuildF0();
+  // Only analyzes the samples around frames [start, start + length). Other
+  // frames are left unvoiced.
+  void BuildF0(int start, int length);
   void BuildSp();
   void BuildAp();
   void BuildResidual();
 
-  void SynthParams(std::vector<std::vector<double>>* tension,
+  // Neutral curves for Synth, one value per frame.
+  void SynthParams(std::vector<double>* tension,
                    std::vector<double>* breathiness,
                    std::vector<double>* voicing);
-  void Synth(std::vector<std::vector<double>>& tension,
-             std::vector<double>& breathiness, std::vector<double>& voicing);
+  // tension is the GetTensionCoefficients value of each frame, shaped around
+  // tension_f0.
+  void Synth(const std::vector<double>& tension,
+             const std::vector<double>& tension_f0,
+             const std::vector<double>& breathiness,
+             const std::vector<double>& voicing);
+  // Same as Synth, but the samples are read from the returned stream while
+  // they are synthesized. The model and the curves must outlive the stream.
+  std::unique_ptr<SynthesisStream> SynthStream(
+      const std::vector<double>& tension,
+      const std::vector<double>& tension_f0,
+      const std::vector<double>& breathiness,
+      const std::vector<double>& voicing);
   void SynthPlatinum();
 
+  // Scales samples, and sp built afterwards, by gain.
+  void Scale(double gain);
   void Trim(int start, int length);
   void Remap(const std::vector<double>& frame_positions);
 
   double GetVoicedRatio();
   int MsToSamples(double ms);
-
-  std::vector<double>& samples() { return samples_; }
+  // Number of samples synthesized from the frames.
+  int SynthLength();
+  // Memory held by the samples and features. Borrowed samples are not
+  // counted.
+  std::size_t Bytes() const;
+
+  absl::Span<const double> samples() const {
+    return borrowed_ != nullptr ? borrowed_range_
+                                : absl::MakeConstSpan(samples_);
+  }
+  // Copies borrowed samples first.
+  std::vector<double>& mutable_samples();
   int fs() { return fs_; }
-  double total_ms() { return samples_.size() * 1000.0 / fs_; }
+  double total_ms() { return samples().size() * 1000.0 / fs_; }
 
   double frame_ms() { return frame_ms_; }
 
@@ -42,12 +125,25 @@ class Model {
   std::vector<double>& ts() { return ts_; }
 
   int fft_size() { return fft_size_; }
-  std::vector<std::vector<double>>& sp() { return sp_; }
-  std::vector<std::vector<double>>& ap() { return ap_; }
-  std::vector<std::vector<double>>& residual() { return residual_; }
+  FrameMatrix& sp() { return sp_; }
+  FrameMatrix& ap() { return ap_; }
+  FrameMatrix& residual() { return residual_; }
 
  private:
+  bool LoadStoredF0(std::uint64_t hash);
+  // Analyzes ap of every step-th frame and lerps the others.
+  void BuildDecimatedAp(const D4COption& d4c_option, int step);
+  // Settings of sp and ap, for their cache keys.
+  std::uint64_t OptionsKey() const;
+  void EstimateF0(const std::vector<double>& samples, std::uint64_t hash,
+                  std::vector<double>* f0, std::vector<double>* ts);
+  // All samples as a vector, copied only if a borrowed view was trimmed.
+  const std::vector<double>& SampleVector();
+
+  // Unused while borrowed_ is set.
   std::vector<double> samples_;
+  std::shared_ptr<const std::vector<double>> borrowed_;
+  absl::Span<const double> borrowed_range_;
   int fs_;
 
   std::unique_ptr<F0Estimator> f0_estimator_;
@@ -57,9 +153,19 @@ class Model {
   std::vector<double> ts_;
 
   int fft_size_;
-  std::vector<std::vector<double>> sp_;
-  std::vector<std::vector<double>> ap_;
-  std::vector<std::vector<double>> residual_;
+  FrameMatrix sp_;
+  FrameMatrix ap_;
+  FrameMatrix residual_;
+
+  // Set when f0 was read from a mounted feature store, so that sp and ap of
+  // the same frames can be read too. store_offset_ is the first frame of the
+  // model within the stored entry.
+  std::shared_ptr<const FeatureStore> store_;
+  FeatureStore::Features stored_;
+  int store_offset_ = 0;
+  double gain_ = 1;
+  QualityTier quality_ = QualityTier::kFinal;
+  bool cache_frames_ = true;
 };
 
 }  // namespace worldline
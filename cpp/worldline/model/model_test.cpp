@@ -0,0 +1,108 @@
+#include "worldline/model/model.h"
+
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "worldline/classic/frq.h"
+#include "worldline/classic/timing.h"
+#include "worldline/common/frame_matrix.h"
+#include "worldline/synth_request.h"
+
+namespace worldline {
+namespace {
+
+constexpr double kFrameMs = 10;
+
+FrameMatrix Iota(int rows, int width) {
+  FrameMatrix matrix(rows, width);
+  for (int i = 0; i < rows; ++i) {
+    for (int j = 0; j < width; ++j) {
+      matrix[i][j] = i * 1000 + j;
+    }
+  }
+  return matrix;
+}
+
+TEST(ModelTest, RemapsPaddedIdentityInPlace) {
+  Model model(44100, kFrameMs, 2048);
+  for (int i = 0; i < 10; ++i) {
+    model.f0().push_back(100 + i);
+  }
+  // Rows trimmed off the front leave room to pad into, as after Model::Trim.
+  model.sp() = Iota(12, 5);
+  model.sp().Trim(2, 10);
+  model.ap() = Iota(12, 5);
+  model.ap().Trim(2, 10);
+  const double* sp0 = model.sp()[0];
+
+  // Unstretched, as Resampler and PhraseSynth build it.
+  SynthRequest request = {};
+  request.con_vel = 100;
+  request.offset = 0;
+  request.consonant = 30;
+  request.cut_off = -80;
+  request.required_length = 60;
+  std::vector<double> mapping = GetTimeMapping(model, request);
+  ShiftTimeMapping(mapping, 0);
+  PadTimeMapping(mapping, 2);
+  ASSERT_EQ(mapping.size(), 11);
+  model.Remap(mapping);
+
+  ASSERT_EQ(model.f0().size(), 11);
+  ASSERT_EQ(model.sp().rows(), 11);
+  ASSERT_EQ(model.ap().rows(), 11);
+  EXPECT_EQ(model.sp()[2], sp0);
+  for (int k = 0; k < 11; ++k) {
+    int frame = static_cast<int>(mapping[k] / kFrameMs);
+    EXPECT_EQ(model.f0()[k], 100 + frame) << k;
+    for (int j = 0; j < 5; ++j) {
+      EXPECT_EQ(model.sp()[k][j], (frame + 2) * 1000 + j) << k;
+      EXPECT_EQ(model.ap()[k][j], (frame + 2) * 1000 + j) << k;
+    }
+  }
+}
+
+TEST(ModelTest, RemapsStretchedMappingByLerp) {
+  Model model(44100, kFrameMs, 2048);
+  model.f0() = {100, 200, 300};
+  model.sp() = Iota(3, 2);
+  model.ap() = Iota(3, 2);
+  std::vector<double> mapping = {0, 5, 10, 15, 20};
+  PadTimeMapping(mapping, 2);
+  model.Remap(mapping);
+  ASSERT_EQ(model.f0().size(), 9);
+  EXPECT_EQ(model.f0()[0], 100);
+  EXPECT_EQ(model.f0()[3], 150);
+  EXPECT_EQ(model.f0()[8], 300);
+  EXPECT_EQ(model.sp()[3][1], 501);
+}
+
+TEST(WriteBackFrqTest, ReadsFileWrittenMeanwhile) {
+  std::filesystem::path path =
+      std::filesystem::path(testing::TempDir()) / "write_back_wav.frq";
+  std::string frq = DumpFrq(FrqData{256, 220, {220, 220}, {0.5, 0.5}});
+  ASSERT_TRUE(WriteFrqFile(path, frq));
+  // Calls racing for one path all get the content of the first write.
+  std::vector<double> samples(4410);
+  std::vector<std::string> results(4);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < results.size(); ++i) {
+    threads.emplace_back([&, i]() {
+      results[i] = WriteBackFrq(samples, 44100, 0, path);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& result : results) {
+    EXPECT_EQ(result, frq);
+  }
+  EXPECT_EQ(ReadFrqFile(path), frq);
+  std::filesystem::remove(path);
+}
+
+}  // namespace
+}  // namespace worldline
@@ -0,0 +1,106 @@
+// Times Model::Remap against the previous implementation, which lerped
+// frames into freshly allocated std::vector rows.
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "worldline/classic/timing.h"
+#include "worldline/common/frame_matrix.h"
+#include "worldline/common/timer.h"
+#include "worldline/model/model.h"
+
+namespace {
+
+constexpr int kFs = 44100;
+constexpr double kFrameMs = 10;
+constexpr int kFftSize = 2048;
+constexpr int kWidth = kFftSize / 2 + 1;
+constexpr int kFrames = 150;
+constexpr int kRuns = 20;
+
+using Frames = std::vector<std::vector<double>>;
+
+std::vector<double> Lerp(const std::vector<double>& vec0,
+                         const std::vector<double>& vec1, double t) {
+  std::vector<double> result(vec0.size());
+  for (int i = 0; i < vec0.size(); ++i) {
+    result[i] = vec0[i] * (1.0 - t) + vec1[i] * t;
+  }
+  return result;
+}
+
+void LegacyRemap(const std::vector<double>& mapping, std::vector<double>& f0,
+                 Frames& sp, Frames& ap) {
+  std::vector<double> new_f0;
+  Frames new_sp;
+  Frames new_ap;
+  new_f0.reserve(mapping.size());
+  new_sp.reserve(mapping.size());
+  new_ap.reserve(mapping.size());
+  for (double p : mapping) {
+    double pos = p / kFrameMs;
+    int idx = static_cast<int>(pos);
+    double t = pos - idx;
+    int i0 = std::min(idx, (int)f0.size() - 1);
+    int i1 = std::min(idx + 1, (int)f0.size() - 1);
+    new_f0.push_back(f0[i0] * (1.0 - t) + f0[i1] * t);
+    new_sp.push_back(Lerp(sp[i0], sp[i1], t));
+    new_ap.push_back(Lerp(ap[i0], ap[i1], t));
+  }
+  f0 = std::move(new_f0);
+  sp = std::move(new_sp);
+  ap = std::move(new_ap);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  // Notes of 1.5 s stretched to 3 s, rendered one after another as in
+  // PhraseSynth: analyze, remap, keep the result.
+  std::vector<double> mapping;
+  for (double p = 0; p < (kFrames - 1) * kFrameMs; p += kFrameMs * 0.5) {
+    mapping.push_back(p);
+  }
+  // Unstretched, padded like the mappings of Resampler and PhraseSynth.
+  std::vector<double> identity;
+  for (int i = 0; i < kFrames - 2; ++i) {
+    identity.push_back(i * kFrameMs);
+  }
+  worldline::PadTimeMapping(identity, 2);
+  std::cout << kRuns << " notes, " << kFrames << " -> " << mapping.size()
+            << " frames" << std::endl;
+
+  worldline::Timer timer("remap");
+  {
+    std::vector<Frames> results;
+    for (int i = 0; i < kRuns; ++i) {
+      std::vector<double> f0(kFrames, 220);
+      Frames sp(kFrames, std::vector<double>(kWidth, 1e-3));
+      Frames ap(kFrames, std::vector<double>(kWidth, 0.5));
+      LegacyRemap(mapping, f0, sp, ap);
+      results.push_back(std::move(sp));
+      results.push_back(std::move(ap));
+    }
+    timer.AddPoint("vector rows");
+  }
+  timer.AddPoint("free");
+  for (const auto* positions : {&mapping, &identity}) {
+    std::vector<worldline::Model> results;
+    for (int i = 0; i < kRuns; ++i) {
+      worldline::Model model(kFs, kFrameMs, kFftSize);
+      model.f0() = std::vector<double>(kFrames, 220);
+      model.sp() = worldline::FrameMatrix(kFrames, kWidth, 1e-3);
+      model.ap() = worldline::FrameMatrix(kFrames, kWidth, 0.5);
+      model.Remap(*positions);
+      results.push_back(std::move(model));
+    }
+    timer.AddPoint(positions == &mapping ? "Model::Remap"
+                                         : "Model::Remap identity");
+    results.clear();
+    timer.AddPoint("free");
+  }
+  timer.Print();
+  return 0;
+}
@@ -0,0 +1,112 @@
+#include "sample_store.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "worldline/common/wav_reader.h"
+
+namespace worldline {
+
+SampleStore& SampleStore::Global() {
+  static SampleStore* store = new SampleStore();
+  return *store;
+}
+
+std::int64_t SampleStore::Load(const std::string& path) {
+  std::error_code error;
+  auto time =
+      std::filesystem::last_write_time(std::filesystem::u8path(path), error);
+  if (error) {
+    return 0;
+  }
+  auto share = [&]() -> std::int64_t {
+    auto it = handles_.find(path);
+    if (it == handles_.end() || entries_[it->second].time != time) {
+      return 0;
+    }
+    entries_[it->second].refs++;
+    return it->second;
+  };
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (std::int64_t handle = share()) {
+      return handle;
+    }
+  }
+
+  // Decoded outside of the lock, so that other samples load meanwhile.
+  auto sample = std::make_shared<Sample>();
+  if (!ReadWav(path, &sample->samples, &sample->fs)) {
+    return 0;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (std::int64_t handle = share()) {
+    return handle;
+  }
+  // A changed file gets a new handle. Holders of the old one keep reading
+  // the old samples until they release it.
+  std::int64_t handle = next_handle_++;
+  entries_[handle] = Entry{path, time, 1, std::move(sample)};
+  handles_[path] = handle;
+  return handle;
+}
+
+std::shared_ptr<const SampleStore::Sample> SampleStore::Get(
+    std::int64_t handle) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(handle);
+  return it == entries_.end() ? nullptr : it->second.sample;
+}
+
+bool SampleStore::Retain(std::int64_t handle) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(handle);
+  if (it == entries_.end()) {
+    return false;
+  }
+  it->second.refs++;
+  return true;
+}
+
+void SampleStore::Release(std::int64_t handle) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(handle);
+  if (it == entries_.end() || --it->second.refs > 0) {
+    return;
+  }
+  auto latest = handles_.find(it->second.path);
+  if (latest != handles_.end() && latest->second == handle) {
+    handles_.erase(latest);
+  }
+  entries_.erase(it);
+}
+
+std::size_t SampleStore::size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+std::shared_ptr<const std::vector<double>> RequestSamples(
+    const SynthRequest& request) {
+  if (request.sample_handle != 0) {
+    std::shared_ptr<const SampleStore::Sample> sample =
+        SampleStore::Global().Get(request.sample_handle);
+    if (sample == nullptr) {
+      return std::make_shared<const std::vector<double>>();
+    }
+    // Shares ownership of the whole sample.
+    return std::shared_ptr<const std::vector<double>>(sample,
+                                                      &sample->samples);
+  }
+  return std::make_shared<const std::vector<double>>(
+      request.sample, request.sample + request.sample_length);
+}
+
+}  // namespace worldline
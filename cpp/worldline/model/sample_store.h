@@ -0,0 +1,66 @@
+#ifndef WORLDLINE_MODEL_SAMPLE_STORE_H_
+#define WORLDLINE_MODEL_SAMPLE_STORE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "worldline/synth_request.h"
+
+namespace worldline {
+
+// Process-wide store of decoded wav files, so that requests of the same
+// sample share one buffer instead of each decoding and copying it. Load
+// returns a handle and takes a reference to it, which Release drops. A
+// sample is freed once no handle refers to it and no model borrows it.
+// Thread safe.
+class SampleStore {
+ public:
+  struct Sample {
+    std::vector<double> samples;
+    int fs;
+  };
+
+  static SampleStore& Global();
+
+  // Decodes the wav file at path, UTF-8, or shares it if it is loaded and
+  // unchanged on disk. Returns its handle, or 0 if it cannot be read.
+  std::int64_t Load(const std::string& path);
+  // Returns nullptr if the handle was released.
+  std::shared_ptr<const Sample> Get(std::int64_t handle);
+  // Takes another reference to a handle that is still held. Returns false
+  // if it was released.
+  bool Retain(std::int64_t handle);
+  void Release(std::int64_t handle);
+
+  // Number of samples held by handles.
+  std::size_t size();
+
+ private:
+  struct Entry {
+    std::string path;
+    std::filesystem::file_time_type time;
+    int refs;
+    std::shared_ptr<const Sample> sample;
+  };
+
+  std::mutex mutex_;
+  std::int64_t next_handle_ = 1;
+  std::unordered_map<std::int64_t, Entry> entries_;
+  // Handle of the latest load of each path.
+  std::unordered_map<std::string, std::int64_t> handles_;
+};
+
+// Samples of request, from the store if it has a sample_handle, otherwise
+// copied from request.sample. Empty if the handle was released.
+std::shared_ptr<const std::vector<double>> RequestSamples(
+    const SynthRequest& request);
+
+}  // namespace worldline
+
+#endif  // WORLDLINE_MODEL_SAMPLE_STORE_H_
@@ -0,0 +1,121 @@
+#include "worldline/model/sample_store.h"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace worldline {
+namespace {
+
+void Append(std::uint32_t value, int bytes, std::string* out) {
+  for (int i = 0; i < bytes; ++i) {
+    out->push_back(static_cast<char>(value >> (8 * i)));
+  }
+}
+
+// 16-bit mono wav at 44100 Hz.
+void WriteWav(const std::filesystem::path& path,
+              const std::vector<std::int16_t>& values) {
+  std::string wav = "RIFF";
+  Append(36 + 2 * values.size(), 4, &wav);
+  wav += "WAVEfmt ";
+  Append(16, 4, &wav);
+  Append(1, 2, &wav);
+  Append(1, 2, &wav);
+  Append(44100, 4, &wav);
+  Append(44100 * 2, 4, &wav);
+  Append(2, 2, &wav);
+  Append(16, 2, &wav);
+  wav += "data";
+  Append(2 * values.size(), 4, &wav);
+  for (std::int16_t value : values) {
+    Append(static_cast<std::uint16_t>(value), 2, &wav);
+  }
+  std::ofstream(path, std::ios::binary) << wav;
+}
+
+std::filesystem::path TempPath(const std::string& name) {
+  return std::filesystem::path(testing::TempDir()) / name;
+}
+
+TEST(SampleStoreTest, SharesLoadsUntilReleased) {
+  std::filesystem::path path = TempPath("sample_store_shared.wav");
+  WriteWav(path, {0, 16384, -16384});
+  SampleStore store;
+  std::int64_t handle = store.Load(path.string());
+  ASSERT_NE(handle, 0);
+  EXPECT_EQ(store.Load(path.string()), handle);
+  EXPECT_EQ(store.size(), 1);
+
+  std::shared_ptr<const SampleStore::Sample> sample = store.Get(handle);
+  ASSERT_NE(sample, nullptr);
+  EXPECT_EQ(sample->fs, 44100);
+  EXPECT_EQ(sample->samples, (std::vector<double>{0, 0.5, -0.5}));
+
+  EXPECT_TRUE(store.Retain(handle));
+  store.Release(handle);
+  store.Release(handle);
+  EXPECT_NE(store.Get(handle), nullptr);
+  store.Release(handle);
+  EXPECT_EQ(store.Get(handle), nullptr);
+  EXPECT_EQ(store.size(), 0);
+  EXPECT_FALSE(store.Retain(handle));
+  // Samples still in use outlive their handle.
+  EXPECT_EQ(sample->samples.size(), 3);
+  std::filesystem::remove(path);
+}
+
+TEST(SampleStoreTest, ReloadsChangedFiles) {
+  std::filesystem::path path = TempPath("sample_store_changed.wav");
+  WriteWav(path, {0, 16384});
+  SampleStore store;
+  std::int64_t old_handle = store.Load(path.string());
+  WriteWav(path, {0, 16384, 16384});
+  std::filesystem::last_write_time(
+      path, std::filesystem::last_write_time(path) + std::chrono::hours(1));
+  std::int64_t new_handle = store.Load(path.string());
+  ASSERT_NE(new_handle, 0);
+  EXPECT_NE(new_handle, old_handle);
+  EXPECT_EQ(store.Get(old_handle)->samples.size(), 2);
+  EXPECT_EQ(store.Get(new_handle)->samples.size(), 3);
+
+  // Releasing the old handle keeps the new one as the latest load.
+  store.Release(old_handle);
+  EXPECT_EQ(store.Load(path.string()), new_handle);
+  std::filesystem::remove(path);
+}
+
+TEST(SampleStoreTest, RejectsMissingFiles) {
+  SampleStore store;
+  EXPECT_EQ(store.Load(TempPath("sample_store_missing.wav").string()), 0);
+  EXPECT_EQ(store.Get(0), nullptr);
+}
+
+TEST(SampleStoreTest, ReadsRequestSamples) {
+  std::filesystem::path path = TempPath("sample_store_request.wav");
+  WriteWav(path, {16384});
+  SampleStore& store = SampleStore::Global();
+  SynthRequest request = {};
+  request.sample_handle = store.Load(path.string());
+  std::shared_ptr<const std::vector<double>> samples = RequestSamples(request);
+  EXPECT_EQ(samples.get(), &store.Get(request.sample_handle)->samples);
+  store.Release(request.sample_handle);
+  EXPECT_EQ(*samples, std::vector<double>{0.5});
+  EXPECT_TRUE(RequestSamples(request)->empty());
+
+  double raw[] = {0.25, -0.25};
+  request.sample_handle = 0;
+  request.sample = raw;
+  request.sample_length = 2;
+  EXPECT_EQ(*RequestSamples(request), (std::vector<double>{0.25, -0.25}));
+  std::filesystem::remove(path);
+}
+
+}  // namespace
+}  // namespace worldline
@@ -0,0 +1,52 @@
+// Times tension envelopes of a long phrase computed for every frame, as
+// synthesis used to, against lookups in the shared table.
+
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "worldline/common/timer.h"
+#include "worldline/model/effects.h"
+
+namespace {
+
+constexpr int kFs = 44100;
+constexpr int kWidth = 1025;
+// 60 s of 10 ms frames.
+constexpr int kFrames = 6000;
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  // Vibrato around a slowly rising pitch, with tension drawn in steps.
+  std::vector<double> f0(kFrames);
+  std::vector<int> tension(kFrames);
+  for (int i = 0; i < kFrames; ++i) {
+    f0[i] = 220 * std::pow(2, i / 6000.0) *
+            std::pow(2, 0.5 / 12 * std::sin(i * 0.35));
+    tension[i] = (i / 400 % 5) * 10 - 20;
+  }
+  std::cout << kFrames << " frames" << std::endl;
+
+  double checksum = 0;
+  worldline::Timer timer("tension");
+  std::vector<double> envelope(kWidth);
+  for (int i = 0; i < kFrames; ++i) {
+    worldline::GetTensionCoefficients(f0[i], kFs, tension[i], kWidth,
+                                      envelope.data());
+    checksum += envelope[kWidth / 2];
+  }
+  timer.AddPoint("per frame");
+  for (int pass = 0; pass < 2; ++pass) {
+    for (int i = 0; i < kFrames; ++i) {
+      auto cached = worldline::GetCachedTensionCoefficients(f0[i], kFs,
+                                                            tension[i], kWidth);
+      checksum += (*cached)[kWidth / 2];
+    }
+    timer.AddPoint(pass == 0 ? "table, cold" : "table, warm");
+  }
+  timer.Print();
+  std::cout << "checksum " << checksum << std::endl;
+  return 0;
+}
@@ -1,17 +1,24 @@
 #include "phrase_synth.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
-#include <iterator>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
 #include <vector>
 
 #include "world/constantnumbers.h"
 #include "worldline/classic/timing.h"
+#include "worldline/common/frame_matrix.h"
+#include "worldline/common/thread_pool.h"
 #include "worldline/common/vec_utils.h"
-#include "worldline/f0/f0_estimator.h"
-#include "worldline/f0/frq_estimator.h"
-#include "worldline/f0/pyin_estimator.h"
+#include "worldline/model/analysis_cache.h"
 #include "worldline/model/effects.h"
+#include "worldline/model/sample_store.h"
 
 namespace worldline {
 
@@ -22,30 +29,176 @@ static int ceil_int(double v) { return static_cast<int>(ceil(v)); }
 static int floor_int(double v) { return static_cast<int>(floor(v)); }
 static int round_int(double v) { return static_cast<int>(round(v)); }
 
-void PhraseSynth::AddRequest(const SynthRequest& request, double pos_ms,
-                             double skip_ms, double length_ms,
-                             double fade_in_ms, double fade_out_ms,
+// 10ms fade out to ease abruptive ending.
+static int FadeOutSamples(int fs) {
+  return static_cast<int>(fs * 10.0 / 1000.0);
+}
+
+// Upgrades posted by all phrases that have not run yet, and the bytes of
+// samples and frq they hold.
+static std::atomic<std::int64_t> pending_upgrades{0};
+static std::atomic<std::int64_t> pending_upgrade_bytes{0};
+
+bool PhraseSynth::SetQuality(QualityTier quality, bool upgrade) {
+  if (next_id_ > 0) {
+    return false;
+  }
+  quality_ = quality;
+  upgrade_ = upgrade;
+  return true;
+}
+
+int PhraseSynth::AddRequest(const SynthRequest& request, double pos_ms,
+                            double skip_ms, double length_ms,
+                            double fade_in_ms, double fade_out_ms,
+                            LogCallback logCallback) {
+  RequestTiming timing{pos_ms, skip_ms, length_ms, fade_in_ms, fade_out_ms};
+  return AddRequests(&request, &timing, 1, logCallback);
+}
+
+int PhraseSynth::AddRequests(const SynthRequest* requests,
+                             const RequestTiming* timings, int count,
                              LogCallback logCallback) {
-  std::vector<double> samples;
-  samples.reserve(request.sample_length);
-  std::copy(request.sample, request.sample + request.sample_length,
-            std::back_inserter(samples));
+  Invalidate();
+  int first_id = next_id_;
+  // With fold_on_add, only as many notes as can be analyzed at once are
+  // held before they are folded, so that memory does not grow with count.
+  ThreadPool& pool = ThreadPool::Global();
+  int window = fold_on_add_ ? pool.size() + 1 : count;
+  for (int begin = 0; begin < count; begin += window) {
+    int n = std::min(window, count - begin);
+    const SynthRequest* batch = requests + begin;
+    std::vector<std::unique_ptr<Model>> models(n);
+    std::vector<std::shared_ptr<const std::vector<double>>> samples(n);
+    pool.ParallelFor(n, [&](int i) {
+      samples[i] = RequestSamples(batch[i]);
+      models[i] = std::make_unique<Model>(
+          Analyze(batch[i], samples[i], quality_, !fold_on_add_));
+    });
+    if (upgrade_ && quality_ != QualityTier::kFinal) {
+      for (int i = 0; i < n; ++i) {
+        PostUpgrade(batch[i], samples[i]);
+      }
+    }
+    std::size_t models_bytes = 0;
+    for (int i = 0; i < n; ++i) {
+      models_bytes += models[i]->Bytes();
+    }
+    UpdatePeak(models_bytes);
+    if (fs_ == 0) {
+      fs_ = models[0]->fs();
+      frame_ms_ = models[0]->frame_ms();
+      fft_size_ = models[0]->fft_size();
+    }
+    for (int i = 0; i < n; ++i) {
+      ModelTiming timing = GetModelTiming(timings[begin + i]);
+      if (fold_on_add_) {
+        Fold(*models[i], timing, &folded_);
+        models[i].reset();
+        next_id_++;
+        continue;
+      }
+      notes_.push_back(Note{next_id_++, std::move(*models[i]), timing});
+    }
+  }
+  UpdatePeak(0);
+  return first_id;
+}
 
-  std::unique_ptr<F0Estimator> f0_estimator = nullptr;
-  if (request.frq_length > 0) {
-    std::string_view frq_data(request.frq, request.frq_length);
-    f0_estimator = std::make_unique<FrqEstimator>(frq_data);
-  } else {
-    f0_estimator = std::make_unique<PyinEstimator>();
+bool PhraseSynth::ReplaceRequest(int id, const SynthRequest& request,
+                                 const RequestTiming& timing,
+                                 LogCallback logCallback) {
+  Note* note = FindNote(id);
+  if (note == nullptr) {
+    return false;
   }
+  std::shared_ptr<const std::vector<double>> samples = RequestSamples(request);
+  note->model = Analyze(request, samples, quality_, true);
+  if (upgrade_ && quality_ != QualityTier::kFinal) {
+    PostUpgrade(request, samples);
+  }
+  note->timing = GetModelTiming(timing);
+  Invalidate();
+  return true;
+}
 
+bool PhraseSynth::RemoveRequest(int id) {
+  Note* note = FindNote(id);
+  if (note == nullptr) {
+    return false;
+  }
+  notes_.erase(notes_.begin() + (note - notes_.data()));
+  Invalidate();
+  return true;
+}
+
+bool PhraseSynth::UpdateTiming(int id, const RequestTiming& timing) {
+  Note* note = FindNote(id);
+  if (note == nullptr) {
+    return false;
+  }
+  note->timing = GetModelTiming(timing);
+  Invalidate();
+  return true;
+}
+
+PhraseSynth::Note* PhraseSynth::FindNote(int id) {
+  for (auto& note : notes_) {
+    if (note.id == id) {
+      return &note;
+    }
+  }
+  return nullptr;
+}
+
+bool PhraseSynth::Empty() const {
+  return fold_on_add_ ? next_id_ == 0 : notes_.empty();
+}
+
+void PhraseSynth::Invalidate() {
+  stream_.reset();
+  if (fold_on_add_ && phrase_ != nullptr) {
+    FrameMatrix& sp = phrase_->sp();
+    for (int i = 0; i < unshifted_sp_.size(); ++i) {
+      std::copy(unshifted_sp_[i].begin(), unshifted_sp_[i].end(), sp[i]);
+    }
+    // Without the row added by Join.
+    int rows = joined_f0_.size() - 1;
+    joined_f0_.resize(rows);
+    sp.Trim(0, rows);
+    phrase_->ap().Trim(0, rows);
+    folded_.f0 = std::move(joined_f0_);
+    folded_.sp = std::move(sp);
+    folded_.ap = std::move(phrase_->ap());
+  }
+  phrase_.reset();
+  joined_f0_.clear();
+  unshifted_sp_.clear();
+  output_.clear();
+}
+
+Model PhraseSynth::Analyze(const SynthRequest& request,
+                           std::shared_ptr<const std::vector<double>> samples,
+                           QualityTier quality, bool cache_frames) {
+  std::string_view frq_data;
+  std::string written_frq;
+  if (request.frq_length > 0) {
+    frq_data = std::string_view(request.frq, request.frq_length);
+  } else if (request.frq_write_path != nullptr &&
+             quality == QualityTier::kFinal) {
+    written_frq =
+        WriteBackFrq(*samples, request.sample_fs, request.sample_tone,
+                     std::filesystem::u8path(request.frq_write_path));
+    frq_data = written_frq;
+  }
   Model model(std::move(samples), request.sample_fs, frame_ms,
-              std::move(f0_estimator));
+              MakeF0Estimator(frq_data, quality, request.sample_tone));
+  model.set_quality(quality);
+  model.set_cache_frames(cache_frames);
 
+  // Peak of the whole file, even though only the input region is analyzed.
   double src_max = vec_maxabs(model.samples());
 
-  model.BuildF0();
-
   auto mapping = GetTimeMapping(model, request);
 
   // Trim model to input region.
@@ -57,11 +210,12 @@ void PhraseSynth::AddRequest(const SynthRequest& request, double pos_ms,
       in_start_frame;
   double left_trimmed = in_start_frame * frame_ms;
 
+  model.BuildF0(in_start_frame, in_length_frame);
   model.Trim(in_start_frame, in_length_frame);
 
   double seg_max = vec_maxabs(model.samples());
-  AutoGain(model.samples(), src_max, seg_max, model.GetVoicedRatio(),
-           request.volume, request.flag_P);
+  model.Scale(GetAutoGain(src_max, seg_max, model.GetVoicedRatio(),
+                          request.volume, request.flag_P));
 
   model.BuildSp();
   model.BuildAp();
@@ -70,116 +224,375 @@ void PhraseSynth::AddRequest(const SynthRequest& request, double pos_ms,
   PadTimeMapping(mapping, padding);
 
   model.Remap(mapping);
+  return model;
+}
+
+void PhraseSynth::PostUpgrade(
+    const SynthRequest& request,
+    std::shared_ptr<const std::vector<double>> samples) {
+  if (!AnalysisCache::Global().enabled()) {
+    return;
+  }
+  // The buffers and the sample handle of request belong to the caller, and
+  // may be freed before the task runs. samples are shared with the note.
+  struct Upgrade {
+    SynthRequest request;
+    std::shared_ptr<const std::vector<double>> samples;
+    std::string frq;
+  };
+  auto upgrade = std::make_shared<Upgrade>();
+  upgrade->request = request;
+  upgrade->samples = std::move(samples);
+  if (request.frq_length > 0) {
+    upgrade->frq.assign(request.frq, request.frq_length);
+  }
+  upgrade->request.sample = nullptr;
+  upgrade->request.sample_handle = 0;
+  upgrade->request.frq = upgrade->frq.data();
+  // Timing and gain do not depend on pitch bends.
+  upgrade->request.pitch_bend_length = 0;
+  upgrade->request.pitch_bend = nullptr;
+  upgrade->request.frq_write_path = nullptr;
+  std::int64_t bytes =
+      upgrade->samples->size() * sizeof(double) + upgrade->frq.size();
+  // Counted before posting, as the task may finish before Post returns.
+  pending_upgrades++;
+  pending_upgrade_bytes += bytes;
+  bool posted = ThreadPool::Global().Post([upgrade, bytes]() {
+    Analyze(upgrade->request, upgrade->samples, QualityTier::kFinal, true);
+    pending_upgrade_bytes -= bytes;
+    pending_upgrades--;
+  });
+  if (!posted) {
+    pending_upgrade_bytes -= bytes;
+    pending_upgrades--;
+  }
+}
 
-  models_.push_back(std::move(model));
+PhraseSynth::ModelTiming PhraseSynth::GetModelTiming(
+    const RequestTiming& request_timing) {
+  double pos_ms = request_timing.pos_ms;
+  double length_ms = request_timing.length_ms;
   ModelTiming timing;
   timing.left_extra = padding;
-  timing.skip = (int)round(skip_ms / frame_ms);
+  timing.skip = (int)round(request_timing.skip_ms / frame_ms);
   timing.p0 = (int)round(pos_ms / frame_ms);
-  timing.p1 = (int)round((pos_ms + fade_in_ms) / frame_ms);
-  timing.p3 = (int)round((pos_ms + length_ms - fade_out_ms) / frame_ms);
+  timing.p1 = (int)round((pos_ms + request_timing.fade_in_ms) / frame_ms);
+  timing.p3 =
+      (int)round((pos_ms + length_ms - request_timing.fade_out_ms) / frame_ms);
   timing.p4 = (int)round((pos_ms + length_ms) / frame_ms);
   timing.p0 = std::max(0, timing.p0);
   timing.p1 = std::max(timing.p0 + 1, timing.p1);
   timing.p3 = std::min(timing.p4 - 1, timing.p3);
-  timings_.push_back(std::move(timing));
+  return timing;
 }
 
 void PhraseSynth::SetCurves(double* const f0, double* gender, double* tension,
                             double* breathiness, double* voicing, int length,
                             LogCallback logCallback) {
-  std::copy(f0, f0 + length, std::back_inserter(f0_));
-  std::copy(gender, gender + length, std::back_inserter(gender_));
-  std::copy(tension, tension + length, std::back_inserter(tension_));
-  std::copy(breathiness, breathiness + length,
-            std::back_inserter(breathiness_));
-  std::copy(voicing, voicing + length, std::back_inserter(voicing_));
+  curves_.f0.assign(f0, f0 + length);
+  curves_.gender.assign(gender, gender + length);
+  curves_.tension.assign(tension, tension + length);
+  curves_.breathiness.assign(breathiness, breathiness + length);
+  curves_.voicing.assign(voicing, voicing + length);
 }
 
-std::vector<double> PhraseSynth::Synth(LogCallback logCallback) {
-  int fs = models_[0].fs();
-  int fft_size = models_[0].fft_size();
-  int width = models_[0].sp()[0].size();
-
-  std::vector<double> f0;
-  std::vector<std::vector<double>> sp;
-  std::vector<std::vector<double>> ap;
-  std::vector<int> dirty;
-
-  for (int k = 0; k < models_.size(); ++k) {
-    auto& model = models_[k];
-    auto& timing = timings_[k];
-    f0.resize(timing.p4, 0);
-    sp.resize(timing.p4,
-              std::vector<double>(width, world::kMySafeGuardMinimum));
-    ap.resize(timing.p4, std::vector<double>(width, 1));
-    dirty.resize(timing.p4, 0);
-
-    for (int i = timing.p0; i < timing.p4; ++i) {
-      double weight = 1;
-      if (i < timing.p1) {
-        weight = (double)(i - timing.p0) / (timing.p1 - timing.p0);
-      } else if (i >= timing.p3) {
-        weight = (double)(timing.p4 - i) / (timing.p4 - timing.p3);
-      }
-      int model_i = timing.left_extra + timing.skip + i - timing.p0;
-      if (model_i < timing.left_extra) {
-        continue;
-      }
-      if (dirty[i] == 0 || weight > 0.5) {
-        f0[i] = model.f0()[model_i];
-      }
-      for (int j = 0; j < width; j++) {
-        sp[i][j] = sp[i][j] + model.sp()[model_i][j] * weight;
-      }
-      double wa = dirty[i] == 0 ? 0 : 1.0 - weight;
-      double wb = dirty[i] == 0 ? 1 : weight;
-      for (int j = 0; j < width; j++) {
-        ap[i][j] = ap[i][j] * wa + model.ap()[model_i][j] * wb;
-      }
-      dirty[i] = 1;
+void PhraseSynth::Fold(Model& model, const ModelTiming& timing,
+                       Frames* frames) {
+  int width = model.sp().width();
+  if (frames->f0.size() < timing.p4) {
+    if (frames->sp.width() != width) {
+      frames->sp = FrameMatrix(0, width);
+      frames->ap = FrameMatrix(0, width);
+    }
+    frames->f0.resize(timing.p4, 0);
+    frames->sp.Resize(timing.p4, world::kMySafeGuardMinimum);
+    frames->ap.Resize(timing.p4, 1.0);
+    frames->dirty.resize(timing.p4, 0);
+  }
+  std::vector<double>& f0 = frames->f0;
+  FrameMatrix& sp = frames->sp;
+  FrameMatrix& ap = frames->ap;
+  std::vector<int>& dirty = frames->dirty;
+
+  for (int i = timing.p0; i < timing.p4; ++i) {
+    double weight = 1;
+    if (i < timing.p1) {
+      weight = (double)(i - timing.p0) / (timing.p1 - timing.p0);
+    } else if (i >= timing.p3) {
+      weight = (double)(timing.p4 - i) / (timing.p4 - timing.p3);
+    }
+    int model_i = timing.left_extra + timing.skip + i - timing.p0;
+    if (model_i < timing.left_extra) {
+      continue;
+    }
+    if (dirty[i] == 0 || weight > 0.5) {
+      f0[i] = model.f0()[model_i];
+    }
+    double* sp_i = sp[i];
+    const double* model_sp = model.sp()[model_i];
+    for (int j = 0; j < width; j++) {
+      sp_i[j] = sp_i[j] + model_sp[j] * weight;
+    }
+    double wa = dirty[i] == 0 ? 0 : 1.0 - weight;
+    double wb = dirty[i] == 0 ? 1 : weight;
+    double* ap_i = ap[i];
+    const double* model_ap = model.ap()[model_i];
+    for (int j = 0; j < width; j++) {
+      ap_i[j] = ap_i[j] * wa + model_ap[j] * wb;
+    }
+    dirty[i] = 1;
+  }
+}
+
+void PhraseSynth::Join() {
+  Frames frames;
+  if (fold_on_add_) {
+    frames.f0 = std::move(folded_.f0);
+    frames.sp = std::move(folded_.sp);
+    frames.ap = std::move(folded_.ap);
+  } else {
+    for (auto& note : notes_) {
+      Fold(note.model, note.timing, &frames);
     }
   }
+  std::vector<double>& f0 = frames.f0;
+  FrameMatrix& sp = frames.sp;
+  FrameMatrix& ap = frames.ap;
   int length = f0.size() + 1;
   f0.resize(length, f0.back());
-  sp.resize(length, sp.back());
-  ap.resize(length, ap.back());
-
-  f0_.resize(length, f0_.back());
-  gender_.resize(length, gender_.back());
-  tension_.resize(length, tension_.back());
-  breathiness_.resize(length, breathiness_.back());
-  voicing_.resize(length, voicing_.back());
-
-  std::vector<std::vector<double>> ten = vec2d(width, length, 1);
-  std::vector<double> bre(length, 1);
-  std::vector<double> voi(length, 1);
-  for (int i = 0; i < length; ++i) {
-    if (f0[i] > 0) {
-      f0[i] = f0_[i];
-    }
-    ShiftGender(sp[i].data(), width, (gender_[i] - 0.5) * 200);
-    bre[i] = breathiness_[i] > 0.5 ? breathiness_[i] * 4 : breathiness_[i] * 2;
-    ten[i] =
-        GetTensionCoefficients(f0_[i], fs, (tension_[i] - 0.5) * 200, width);
-    voi[i] = voicing_[i];
-  }
-
-  Model final_model(models_[0].fs(), models_[0].frame_ms(),
-                    models_[0].fft_size());
-  final_model.f0() = std::move(f0);
-  final_model.ap() = std::move(ap);
-  final_model.sp() = std::move(sp);
-
-  final_model.Synth(ten, bre, voi);
-  std::vector<double> samples = std::move(final_model.samples());
-
-  // 10ms fade out to ease abruptive ending.
-  int fade_out_samples = static_cast<int>(fs * 10.0 / 1000.0);
+  sp.Resize(length, sp[sp.rows() - 1]);
+  ap.Resize(length, ap[ap.rows() - 1]);
+
+  phrase_ = std::make_unique<Model>(fs_, frame_ms_, fft_size_);
+  phrase_->sp() = std::move(sp);
+  phrase_->ap() = std::move(ap);
+  joined_f0_ = std::move(f0);
+  unshifted_sp_.assign(length, std::vector<double>());
+}
+
+static std::size_t MatrixBytes(const FrameMatrix& frames) {
+  return frames.rows() * frames.stride() * sizeof(double);
+}
+
+std::size_t PhraseSynth::Bytes() const {
+  std::size_t bytes = 0;
+  for (const auto& note : notes_) {
+    bytes += note.model.Bytes();
+  }
+  bytes += folded_.f0.capacity() * sizeof(double) +
+           folded_.dirty.capacity() * sizeof(int) + MatrixBytes(folded_.sp) +
+           MatrixBytes(folded_.ap);
+  bytes += joined_f0_.capacity() * sizeof(double);
+  for (const auto& row : unshifted_sp_) {
+    bytes += row.capacity() * sizeof(double);
+  }
+  if (phrase_ != nullptr) {
+    bytes += phrase_->Bytes();
+  }
+  bytes += (phrase_tension_.capacity() + phrase_breathiness_.capacity() +
+            phrase_voicing_.capacity() + output_.capacity()) *
+           sizeof(double);
+  return bytes;
+}
+
+void PhraseSynth::UpdatePeak(std::size_t extra_bytes) {
+  peak_bytes_ = std::max(peak_bytes_, Bytes() + extra_bytes);
+}
+
+PhraseSynth::MemoryStats PhraseSynth::GetMemoryStats() const {
+  MemoryStats stats;
+  stats.bytes = Bytes();
+  stats.peak_bytes = peak_bytes_;
+  stats.cache_bytes = AnalysisCache::Global().GetStats().bytes;
+  stats.pool_bytes = FrameMatrix::PooledBytes();
+  stats.pending_upgrades = std::max<std::int64_t>(0, pending_upgrades);
+  stats.upgrade_bytes = std::max<std::int64_t>(0, pending_upgrade_bytes);
+  return stats;
+}
+
+bool PhraseSynth::Curves::SameFrame(const Curves& other, int i) const {
+  return f0[i] == other.f0[i] && gender[i] == other.gender[i] &&
+         tension[i] == other.tension[i] &&
+         breathiness[i] == other.breathiness[i] &&
+         voicing[i] == other.voicing[i];
+}
+
+void PhraseSynth::Curves::Resize(int length) {
+  f0.resize(length, f0.back());
+  gender.resize(length, gender.back());
+  tension.resize(length, tension.back());
+  breathiness.resize(length, breathiness.back());
+  voicing.resize(length, voicing.back());
+}
+
+void PhraseSynth::Assemble(int* begin, int* end, bool* f0_changed) {
+  stream_.reset();
+  if (phrase_ == nullptr) {
+    Join();
+    applied_ = Curves();
+  }
+  int width = phrase_->sp().width();
+  int length = joined_f0_.size();
+
+  // Only padded, as notes added later may extend the phrase over the rest.
+  if (curves_.f0.size() < length) {
+    curves_.Resize(length);
+  }
+
+  *begin = 0;
+  *end = length;
+  *f0_changed = true;
+  if (applied_.f0.size() == length) {
+    while (*begin < *end && curves_.SameFrame(applied_, *begin)) {
+      ++*begin;
+    }
+    while (*end > *begin && curves_.SameFrame(applied_, *end - 1)) {
+      --*end;
+    }
+    *f0_changed = !std::equal(curves_.f0.begin() + *begin,
+                              curves_.f0.begin() + *end,
+                              applied_.f0.begin() + *begin);
+  } else {
+    phrase_->f0() = joined_f0_;
+    phrase_tension_.resize(length);
+    phrase_breathiness_.resize(length);
+    phrase_voicing_.resize(length);
+  }
+
+  std::vector<double>& f0 = phrase_->f0();
+  FrameMatrix& sp = phrase_->sp();
+  for (int i = *begin; i < *end; ++i) {
+    if (joined_f0_[i] > 0) {
+      f0[i] = curves_.f0[i];
+    }
+    // Shifted in place from the row as joined.
+    std::vector<double>& unshifted = unshifted_sp_[i];
+    std::copy(unshifted.begin(), unshifted.end(), sp[i]);
+    if (curves_.gender[i] != 0.5) {
+      if (unshifted.empty()) {
+        unshifted.assign(sp[i], sp[i] + width);
+      }
+      ShiftGender(sp[i], width, (curves_.gender[i] - 0.5) * 200);
+    } else {
+      std::vector<double>().swap(unshifted);
+    }
+    double breathiness = curves_.breathiness[i];
+    phrase_breathiness_[i] = breathiness > 0.5 ? breathiness * 4
+                                               : breathiness * 2;
+    phrase_tension_[i] = (curves_.tension[i] - 0.5) * 200;
+    phrase_voicing_[i] = curves_.voicing[i];
+  }
+  applied_ = curves_;
+  applied_.Resize(length);
+  UpdatePeak(0);
+}
+
+void PhraseSynth::Splice(int begin, int end, bool f0_changed) {
+  int y_length = static_cast<int>(output_.size());
+  int fft_size = phrase_->fft_size();
+  double hop = phrase_->fs() * phrase_->frame_ms() / 1000;
+  // Pulses between the frames around the changed ones, their responses, and
+  // a guard band to crossfade in. The noise of a pulse spans the period to
+  // the next one, at most fft_size, so a change of f0 reaches back one pulse
+  // further.
+  int y_begin = std::max(0, static_cast<int>((begin - 1) * hop) -
+                                fft_size / 2 - fft_size -
+                                (f0_changed ? fft_size : 0));
+  int y_end = std::min(
+      y_length, ceil_int((end + 1) * hop) + fft_size / 2 + fft_size);
+  std::unique_ptr<SynthesisStream> stream = phrase_->SynthStream(
+      phrase_tension_, applied_.f0, phrase_breathiness_, phrase_voicing_);
+  stream->Seek(y_begin, y_end);
+  std::vector<double> y(y_end - y_begin);
+  for (int i = 0; i < y.size();) {
+    i += stream->Read(y.data() + i, y.size() - i);
+  }
+
+  // f0 before begin is unchanged, so earlier pulses stay where they were and
+  // the samples outside of the changed frames are the same as before. The
+  // fades only hide rounding differences at the seams.
+  int fade = std::min(fft_size, static_cast<int>(y.size()) / 2);
+  for (int i = 0; i < y.size(); ++i) {
+    double weight = 1;
+    if (y_begin > 0 && i < fade) {
+      weight = (i + 0.5) / fade;
+    }
+    int from_end = y.size() - 1 - i;
+    if (y_end < y_length && from_end < fade) {
+      weight = std::min(weight, (from_end + 0.5) / fade);
+    }
+    double& sample = output_[y_begin + i];
+    sample = sample * (1.0 - weight) + y[i] * weight;
+  }
+}
+
+std::vector<double> PhraseSynth::Synth(LogCallback logCallback) {
+  if (Empty()) {
+    return {};
+  }
+  int begin;
+  int end;
+  bool f0_changed;
+  Assemble(&begin, &end, &f0_changed);
+  // A change of f0 moves the phase of every later pulse, so those are
+  // synthesized again up to the end of the phrase. Splicing pays a guard
+  // band on each side, so it is only worth it for changes late enough.
+  int length = phrase_->f0().size();
+  if (f0_changed) {
+    end = length;
+  }
+  if (output_.size() != phrase_->SynthLength() || end - begin > length / 2) {
+    phrase_->Synth(phrase_tension_, applied_.f0, phrase_breathiness_,
+                   phrase_voicing_);
+    output_ = std::move(phrase_->mutable_samples());
+  } else if (begin < end) {
+    Splice(begin, end, f0_changed);
+  }
+  std::vector<double> samples = output_;
+  UpdatePeak(samples.capacity() * sizeof(double));
+
+  int fade_out_samples = FadeOutSamples(phrase_->fs());
   for (int i = 0; i < fade_out_samples && i < samples.size(); ++i) {
     samples[samples.size() - 1 - i] *= i * 1.0 / fade_out_samples;
   }
   return samples;
 }
 
+int PhraseSynth::BeginStream(LogCallback logCallback) {
+  if (Empty()) {
+    Invalidate();
+    return 0;
+  }
+  int begin;
+  int end;
+  bool f0_changed;
+  Assemble(&begin, &end, &f0_changed);
+  output_.clear();
+  stream_ = phrase_->SynthStream(phrase_tension_, applied_.f0,
+                                 phrase_breathiness_, phrase_voicing_);
+  return stream_->y_length();
+}
+
+int PhraseSynth::Read(float* y, int length) {
+  if (stream_ == nullptr) {
+    return 0;
+  }
+  if (read_block_.size() < length) {
+    read_block_.resize(length);
+  }
+  double* block = read_block_.data();
+  int start = stream_->position();
+  int count = stream_->Read(block, length);
+  int fade_out_samples = FadeOutSamples(phrase_->fs());
+  for (int i = 0; i < count; ++i) {
+    int from_end = stream_->y_length() - 1 - (start + i);
+    if (from_end < fade_out_samples) {
+      block[i] *= from_end * 1.0 / fade_out_samples;
+    }
+    y[i] = static_cast<float>(block[i]);
+  }
+  return count;
+}
+
 }  // namespace worldline
@@ -1,12 +1,15 @@
 #ifndef WORLDLINE_PHRASE_SYNTH_H_
 #define WORLDLINE_PHRASE_SYNTH_H_
 
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "worldline/common/frame_matrix.h"
 #include "worldline/model/model.h"
 #include "worldline/synth_request.h"
+#include "worldline/world_mt/synthesis_mt.h"
 
 namespace worldline {
 
@@ -14,13 +17,69 @@ typedef void(/*__stdcall*/ *LogCallback)(const char* log);
 
 class PhraseSynth {
  public:
-  void AddRequest(const SynthRequest& request, double pos_ms, double skip_ms,
-                  double length_ms, double fade_in_ms, double fade_out_ms,
-                  LogCallback logCallback);
+  struct MemoryStats {
+    std::size_t bytes;
+    std::size_t peak_bytes;
+    // Process-wide, shared by all phrases and not part of bytes: the
+    // analysis cache, freed frame buffers pooled for reuse, and upgrades
+    // posted but not run yet with the samples they hold.
+    std::size_t cache_bytes;
+    std::size_t pool_bytes;
+    std::size_t pending_upgrades;
+    std::size_t upgrade_bytes;
+  };
+
+  // With fold_on_add, each note is crossfaded into the phrase frames as soon
+  // as it is analyzed, and its analysis is freed without being added to the
+  // analysis cache. Memory then grows with the phrase length rather than
+  // with the total length of the notes, but requests can not be replaced,
+  // removed or re-timed.
+  explicit PhraseSynth(bool fold_on_add = false) : fold_on_add_(fold_on_add) {}
+
+  // Quality of the notes analyzed afterwards, overriding the quality of
+  // their requests, as notes of a phrase must share one fft_size. With
+  // upgrade, every note analyzed at preview quality is analyzed again at
+  // final quality in the background, only to fill the analysis cache, so
+  // that a later final render of the same notes skips most analysis.
+  // Returns false, changing nothing, once requests have been added.
+  bool SetQuality(QualityTier quality, bool upgrade);
+
+  // Returns the id of the request, used to edit it later.
+  int AddRequest(const SynthRequest& request, double pos_ms, double skip_ms,
+                 double length_ms, double fade_in_ms, double fade_out_ms,
+                 LogCallback logCallback);
+  // Analyzes requests in parallel. They are added in input order, as if by
+  // AddRequest one after another, and their ids are consecutive starting
+  // from the returned one. With fold_on_add, they are analyzed a pool's
+  // worth at a time, each batch folded and freed before the next.
+  int AddRequests(const SynthRequest* requests, const RequestTiming* timings,
+                  int count, LogCallback logCallback);
+  // Edits of a single request. Other requests keep their analysis. Return
+  // false if there is no request with the id, which is always the case
+  // with fold_on_add.
+  bool ReplaceRequest(int id, const SynthRequest& request,
+                      const RequestTiming& timing, LogCallback logCallback);
+  bool RemoveRequest(int id);
+  bool UpdateTiming(int id, const RequestTiming& timing);
+  // Replaces the curves. The notes are joined only once, so after the first
+  // Synth, changing curves only redoes effects and synthesis, and only of the
+  // frames whose curves changed.
   void SetCurves(double* const f0, double* gender, double* tension,
                  double* breathiness, double* voicing, int length,
                  LogCallback logCallback);
+  // Empty if there are no requests.
   std::vector<double> Synth(LogCallback logCallback);
+  // Prepares the phrase to be read with Read, and returns its length in
+  // samples. Only the first block is synthesized before returning.
+  int BeginStream(LogCallback logCallback);
+  // Writes the next samples of the phrase to y, at most length, and returns
+  // how many were written. Returns 0 at the end of the phrase.
+  int Read(float* y, int length);
+
+  // Memory held for the notes and the phrase, now and at most so far,
+  // including notes being analyzed, along with the current process-wide
+  // memory around them.
+  MemoryStats GetMemoryStats() const;
 
  private:
   struct ModelTiming {
@@ -32,14 +91,101 @@ class PhraseSynth {
     int p4;
   };
 
-  std::vector<Model> models_;
-  std::vector<ModelTiming> timings_;
+  struct Note {
+    int id;
+    Model model;
+    ModelTiming timing;
+  };
+
+  // Notes crossfaded into phrase frames.
+  struct Frames {
+    std::vector<double> f0;
+    FrameMatrix sp;
+    FrameMatrix ap;
+    // Whether any note covers the frame yet.
+    std::vector<int> dirty;
+  };
+
+  struct Curves {
+    std::vector<double> f0;
+    std::vector<double> gender;
+    std::vector<double> tension;
+    std::vector<double> breathiness;
+    std::vector<double> voicing;
+
+    bool SameFrame(const Curves& other, int i) const;
+    // Truncates the curves, or pads them with their last values.
+    void Resize(int length);
+  };
+
+  // samples are those of request, see RequestSamples. cache_frames is
+  // passed to Model::set_cache_frames.
+  static Model Analyze(const SynthRequest& request,
+                       std::shared_ptr<const std::vector<double>> samples,
+                       QualityTier quality, bool cache_frames);
+  // Analyzes a copy of request at final quality on an idle worker. Skipped
+  // when the global pool has no workers, so the note keeps its draft model.
+  static void PostUpgrade(const SynthRequest& request,
+                          std::shared_ptr<const std::vector<double>> samples);
+  static ModelTiming GetModelTiming(const RequestTiming& timing);
+  static void Fold(Model& model, const ModelTiming& timing, Frames* frames);
+  Note* FindNote(int id);
+  // Whether there are no notes to synthesize, e.g. after removing all.
+  bool Empty() const;
+  // Drops everything built from the notes, before they change. With
+  // fold_on_add, the folded frames borrowed by Join are given back.
+  void Invalidate();
+  // Joins the notes into joined_f0_, phrase_->sp() and phrase_->ap(). With
+  // fold_on_add, the folded frames are moved rather than copied.
+  void Join();
+  // Joins the notes if needed and applies the curves into phrase_. Only
+  // frames whose curves changed since the last call are updated, and they
+  // are returned as [begin, end). f0_changed tells whether f0 of any of them
+  // changed too.
+  void Assemble(int* begin, int* end, bool* f0_changed);
+  // Re-synthesizes the samples around frames [begin, end) into output_. With
+  // f0_changed, end must be the end of the phrase.
+  void Splice(int begin, int end, bool f0_changed);
+  std::size_t Bytes() const;
+  void UpdatePeak(std::size_t extra_bytes);
+
+  // In the order they were added, which is also the order they are joined.
+  std::vector<Note> notes_;
+  int next_id_ = 0;
+  bool fold_on_add_;
+  QualityTier quality_ = QualityTier::kFinal;
+  bool upgrade_ = false;
+  // Notes folded so far, with fold_on_add.
+  Frames folded_;
+  // Format of the notes.
+  int fs_ = 0;
+  double frame_ms_ = 0;
+  int fft_size_ = 0;
+
+  Curves curves_;
+  // Curves that phrase_ was last built with.
+  Curves applied_;
+
+  // f0 of the notes joined before the curves are applied. Kept until a
+  // request is added, as curves change far more often than notes.
+  std::vector<double> joined_f0_;
+  // Rows of phrase_->sp() as joined, kept only for rows shifted by the
+  // gender curve so that a later curve can shift them again. Empty for the
+  // others, which are unchanged since the join.
+  std::vector<std::vector<double>> unshifted_sp_;
 
-  std::vector<double> f0_;
-  std::vector<double> gender_;
-  std::vector<double> tension_;
-  std::vector<double> breathiness_;
-  std::vector<double> voicing_;
+  // Synthesis parameters of the whole phrase, built by Assemble. Tension is
+  // shaped around applied_.f0.
+  std::unique_ptr<Model> phrase_;
+  std::vector<double> phrase_tension_;
+  std::vector<double> phrase_breathiness_;
+  std::vector<double> phrase_voicing_;
+  std::unique_ptr<SynthesisStream> stream_;
+  // Scratch of Read, reused so that reads do not allocate.
+  std::vector<double> read_block_;
+  // Last output of Synth before the fade out, spliced into after edits.
+  std::vector<double> output_;
+  std::size_t peak_bytes_ = 0;
 };
 
 }  // namespace worldline
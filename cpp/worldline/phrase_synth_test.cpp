@@ -0,0 +1,267 @@
+#include "worldline/phrase_synth.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "worldline/classic/frq.h"
+#include "worldline/common/thread_pool.h"
+#include "worldline/model/analysis_cache.h"
+#include "worldline/synth_request.h"
+
+namespace worldline {
+namespace {
+
+constexpr int kFs = 44100;
+constexpr double kTone = 220;
+constexpr double kPi = 3.14159265358979323846;
+// Frames of the curves, more than the phrase needs.
+constexpr int kCurveLength = 100;
+
+// One second of a harmonic tone, with a frq file so that no f0 is estimated.
+class PhraseSynthTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    samples_.resize(kFs);
+    for (int i = 0; i < kFs; ++i) {
+      double t = static_cast<double>(i) / kFs;
+      for (int h = 1; h <= 8; ++h) {
+        samples_[i] += 0.3 / h * std::sin(2 * kPi * kTone * h * t);
+      }
+    }
+    int frq_frames = kFs / 256 + 1;
+    frq_ = DumpFrq(FrqData{256, kTone, std::vector<double>(frq_frames, kTone),
+                           std::vector<double>(frq_frames, 0.3)});
+    curves_ = Curves();
+  }
+
+  SynthRequest Request(int tone) {
+    SynthRequest request = {};
+    request.sample_fs = kFs;
+    request.sample_length = samples_.size();
+    request.sample = samples_.data();
+    request.frq_length = frq_.size();
+    request.frq = frq_.data();
+    request.tone = tone;
+    request.con_vel = 100;
+    request.required_length = 400;
+    request.consonant = 50;
+    request.volume = 100;
+    request.tempo = 120;
+    request.flag_P = 86;
+    request.flag_Mv = 100;
+    return request;
+  }
+
+  struct CurveSet {
+    std::vector<double> f0;
+    std::vector<double> gender;
+    std::vector<double> tension;
+    std::vector<double> breathiness;
+    std::vector<double> voicing;
+  };
+
+  static CurveSet Curves() {
+    return CurveSet{std::vector<double>(kCurveLength, kTone),
+                    std::vector<double>(kCurveLength, 0.5),
+                    std::vector<double>(kCurveLength, 0.5),
+                    std::vector<double>(kCurveLength, 0.5),
+                    std::vector<double>(kCurveLength, 1.0)};
+  }
+
+  // Adds two overlapping notes.
+  void AddNotes(PhraseSynth* synth) {
+    synth->AddRequest(Request(57), 0, 0, 400, 50, 50, nullptr);
+    synth->AddRequest(Request(59), 350, 0, 400, 50, 50, nullptr);
+  }
+
+  static void SetCurves(PhraseSynth* synth, CurveSet& curves) {
+    synth->SetCurves(curves.f0.data(), curves.gender.data(),
+                     curves.tension.data(), curves.breathiness.data(),
+                     curves.voicing.data(), kCurveLength, nullptr);
+  }
+
+  // Output of a new phrase of the notes, rendered once with curves.
+  std::vector<double> Render(CurveSet& curves, bool fold_on_add = false) {
+    PhraseSynth synth(fold_on_add);
+    AddNotes(&synth);
+    SetCurves(&synth, curves);
+    return synth.Synth(nullptr);
+  }
+
+  std::vector<double> samples_;
+  std::string frq_;
+  CurveSet curves_;
+};
+
+TEST_F(PhraseSynthTest, CurvesOnlyChangeSkipsAnalysis) {
+  PhraseSynth synth;
+  AddNotes(&synth);
+  SetCurves(&synth, curves_);
+  synth.Synth(nullptr);
+
+  CurveSet changed = Curves();
+  for (int i = 0; i < kCurveLength; ++i) {
+    changed.tension[i] = 0.8;
+    changed.breathiness[i] = 0.3;
+  }
+  AnalysisCache::Stats before = AnalysisCache::Global().GetStats();
+  SetCurves(&synth, changed);
+  std::vector<double> y = synth.Synth(nullptr);
+  AnalysisCache::Stats after = AnalysisCache::Global().GetStats();
+  // Neither the cache nor any estimator is consulted again.
+  EXPECT_EQ(after.hits, before.hits);
+  EXPECT_EQ(after.misses, before.misses);
+
+  ASSERT_FALSE(y.empty());
+  EXPECT_EQ(y, Render(changed));
+}
+
+TEST_F(PhraseSynthTest, SplicedEditMatchesFullRender) {
+  PhraseSynth synth;
+  AddNotes(&synth);
+  SetCurves(&synth, curves_);
+  synth.Synth(nullptr);
+
+  // Few enough frames to be spliced in rather than synthesized again.
+  CurveSet changed = Curves();
+  for (int i = 30; i < 36; ++i) {
+    changed.tension[i] = 0.9;
+    changed.breathiness[i] = 0.8;
+  }
+  SetCurves(&synth, changed);
+  std::vector<double> y = synth.Synth(nullptr);
+  std::vector<double> expected = Render(changed);
+  ASSERT_EQ(y.size(), expected.size());
+  for (int i = 0; i < y.size(); ++i) {
+    ASSERT_NEAR(y[i], expected[i], 1e-9) << "at " << i;
+  }
+}
+
+TEST_F(PhraseSynthTest, LocalF0EditMatchesFullRender) {
+  PhraseSynth synth;
+  AddNotes(&synth);
+  SetCurves(&synth, curves_);
+  synth.Synth(nullptr);
+
+  // Moves the phase of all later pulses, which are spliced in up to the end
+  // of the phrase, being in its second half.
+  CurveSet changed = Curves();
+  for (int i = 50; i < 56; ++i) {
+    changed.f0[i] = kTone * 1.1;
+  }
+  SetCurves(&synth, changed);
+  std::vector<double> y = synth.Synth(nullptr);
+  std::vector<double> expected = Render(changed);
+  ASSERT_EQ(y.size(), expected.size());
+  for (int i = 0; i < y.size(); ++i) {
+    ASSERT_NEAR(y[i], expected[i], 1e-9) << "at " << i;
+  }
+}
+
+TEST_F(PhraseSynthTest, RejectsUnknownAndStaleIds) {
+  PhraseSynth synth;
+  int id = synth.AddRequest(Request(57), 0, 0, 400, 50, 50, nullptr);
+  RequestTiming timing{100, 0, 400, 50, 50};
+  for (int unknown : {-1, id + 1}) {
+    EXPECT_FALSE(synth.ReplaceRequest(unknown, Request(59), timing, nullptr));
+    EXPECT_FALSE(synth.UpdateTiming(unknown, timing));
+    EXPECT_FALSE(synth.RemoveRequest(unknown));
+  }
+  EXPECT_TRUE(synth.RemoveRequest(id));
+  EXPECT_FALSE(synth.ReplaceRequest(id, Request(59), timing, nullptr));
+  EXPECT_FALSE(synth.UpdateTiming(id, timing));
+  EXPECT_FALSE(synth.RemoveRequest(id));
+  // Ids are not reused.
+  EXPECT_NE(synth.AddRequest(Request(57), 0, 0, 400, 50, 50, nullptr), id);
+}
+
+TEST_F(PhraseSynthTest, RemovesLastNote) {
+  PhraseSynth synth;
+  synth.AddRequest(Request(57), 0, 0, 400, 50, 50, nullptr);
+  int id = synth.AddRequest(Request(59), 350, 0, 400, 50, 50, nullptr);
+  SetCurves(&synth, curves_);
+  synth.Synth(nullptr);
+  ASSERT_TRUE(synth.RemoveRequest(id));
+
+  PhraseSynth expected;
+  expected.AddRequest(Request(57), 0, 0, 400, 50, 50, nullptr);
+  SetCurves(&expected, curves_);
+  EXPECT_EQ(synth.Synth(nullptr), expected.Synth(nullptr));
+}
+
+TEST_F(PhraseSynthTest, RemovingAllNotesLeavesNothingToSynthesize) {
+  PhraseSynth synth;
+  int id = synth.AddRequest(Request(57), 0, 0, 400, 50, 50, nullptr);
+  SetCurves(&synth, curves_);
+  EXPECT_FALSE(synth.Synth(nullptr).empty());
+  ASSERT_TRUE(synth.RemoveRequest(id));
+  EXPECT_TRUE(synth.Synth(nullptr).empty());
+  EXPECT_EQ(synth.BeginStream(nullptr), 0);
+  float y[16];
+  EXPECT_EQ(synth.Read(y, 16), 0);
+}
+
+TEST_F(PhraseSynthTest, FoldedNotesCanNotBeEdited) {
+  PhraseSynth synth(/*fold_on_add=*/true);
+  int id = synth.AddRequest(Request(57), 0, 0, 400, 50, 50, nullptr);
+  synth.AddRequest(Request(59), 350, 0, 400, 50, 50, nullptr);
+  SetCurves(&synth, curves_);
+  std::vector<double> y = synth.Synth(nullptr);
+  RequestTiming timing{100, 0, 400, 50, 50};
+  EXPECT_FALSE(synth.ReplaceRequest(id, Request(59), timing, nullptr));
+  EXPECT_FALSE(synth.UpdateTiming(id, timing));
+  EXPECT_FALSE(synth.RemoveRequest(id));
+  EXPECT_EQ(synth.Synth(nullptr), y);
+  EXPECT_EQ(y, Render(curves_, /*fold_on_add=*/true));
+}
+
+TEST_F(PhraseSynthTest, FoldsNotesAddedAfterSynth) {
+  CurveSet curves = Curves();
+  for (int i = 20; i < 60; ++i) {
+    curves.gender[i] = 0.7;
+  }
+  PhraseSynth synth(/*fold_on_add=*/true);
+  synth.AddRequest(Request(57), 0, 0, 400, 50, 50, nullptr);
+  SetCurves(&synth, curves);
+  synth.Synth(nullptr);
+  synth.AddRequest(Request(59), 350, 0, 400, 50, 50, nullptr);
+  EXPECT_EQ(synth.Synth(nullptr), Render(curves, /*fold_on_add=*/true));
+}
+
+TEST_F(PhraseSynthTest, FoldingLowersPeakMemory) {
+  // More notes than are analyzed at once, each overlapping the next.
+  int count = std::max(8, 4 * (ThreadPool::Global().size() + 1));
+  std::vector<SynthRequest> requests;
+  std::vector<RequestTiming> timings;
+  for (int i = 0; i < count; ++i) {
+    requests.push_back(Request(57 + i % 3));
+    timings.push_back(RequestTiming{i * 350.0, 0, 400, 50, 50});
+  }
+  std::vector<PhraseSynth::MemoryStats> stats;
+  for (bool fold_on_add : {false, true}) {
+    AnalysisCache::Global().Clear();
+    PhraseSynth synth(fold_on_add);
+    synth.AddRequests(requests.data(), timings.data(), count, nullptr);
+    stats.push_back(synth.GetMemoryStats());
+  }
+  EXPECT_LT(stats[1].peak_bytes, stats[0].peak_bytes);
+  EXPECT_LT(stats[1].bytes, stats[0].bytes);
+}
+
+TEST_F(PhraseSynthTest, FoldedNotesStayOutOfAnalysisCache) {
+  AnalysisCache::Global().Clear();
+  PhraseSynth synth(/*fold_on_add=*/true);
+  AddNotes(&synth);
+  SetCurves(&synth, curves_);
+  synth.Synth(nullptr);
+  EXPECT_EQ(AnalysisCache::Global().GetStats().entries, 0);
+  PhraseSynth::MemoryStats stats = synth.GetMemoryStats();
+  EXPECT_EQ(stats.cache_bytes, 0);
+  EXPECT_GE(stats.peak_bytes, stats.bytes);
+}
+
+}  // namespace
+}  // namespace worldline
@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/debugging/failure_signal_handler.h"
+#include "absl/debugging/symbolize.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "world/cheaptrick.h"
+#include "worldline/common/wav_reader.h"
+#include "worldline/f0/pyin_estimator.h"
+#include "worldline/model/analysis_cache.h"
+#include "worldline/model/feature_store.h"
+#include "worldline/model/model.h"
+
+ABSL_FLAG(std::string, output, "",
+          "Output file. Defaults to worldline.features in the voicebank.");
+ABSL_FLAG(int, threads, 0, "Number of workers. 0 uses all cores.");
+
+constexpr double frame_ms = 10;
+
+int main(int argc, char** argv) {
+  absl::InitializeSymbolizer(argv[0]);
+  absl::FailureSignalHandlerOptions options;
+  absl::InstallFailureSignalHandler(options);
+
+  std::vector<char*> args = absl::ParseCommandLine(argc, argv);
+  if (args.size() < 2) {
+    std::cout << "usage: prebake [--output=<file>] [--threads=<n>] "
+                 "<voicebank dir>"
+              << std::endl;
+    return 1;
+  }
+  std::filesystem::path root(args[1]);
+  std::string output = absl::GetFlag(FLAGS_output);
+  if (output.empty()) {
+    output = (root / worldline::kFeatureStoreFileName).string();
+  }
+
+  std::vector<std::string> wav_paths;
+  for (const auto& entry :
+       std::filesystem::recursive_directory_iterator(root)) {
+    if (entry.is_regular_file() && entry.path().extension() == ".wav") {
+      wav_paths.push_back(entry.path().string());
+    }
+  }
+  std::sort(wav_paths.begin(), wav_paths.end());
+  if (wav_paths.empty()) {
+    std::cout << "no wav files found in " << root << std::endl;
+    return 1;
+  }
+
+  // All entries of a store share fs, which is taken from the first file.
+  std::unique_ptr<worldline::WavReader> first =
+      worldline::WavReader::Open(wav_paths[0]);
+  if (first == nullptr) {
+    std::cout << "cannot read " << wav_paths[0] << std::endl;
+    return 1;
+  }
+  int fs = first->fs();
+  CheapTrickOption ct_option;
+  InitializeCheapTrickOption(fs, &ct_option);
+  worldline::FeatureStoreWriter writer(output, fs, ct_option.fft_size,
+                                       frame_ms,
+                                       worldline::PyinEstimator().CacheKey());
+  if (!writer.ok()) {
+    std::cout << "cannot write " << output << std::endl;
+    return 1;
+  }
+  // Every sample is analyzed once, caching would only cost memory.
+  worldline::AnalysisCache::Global().SetBudget(0);
+
+  int threads = absl::GetFlag(FLAGS_threads);
+  if (threads <= 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  auto start = std::chrono::steady_clock::now();
+  std::atomic<size_t> next(0);
+  std::atomic<int> baked(0);
+  auto work = [&]() {
+    for (size_t i = next++; i < wav_paths.size(); i = next++) {
+      const std::string& path = wav_paths[i];
+      std::vector<double> samples;
+      int file_fs;
+      if (!worldline::ReadWav(path, &samples, &file_fs) || samples.empty()) {
+        continue;
+      }
+      if (file_fs != fs) {
+        std::cout << "skipping " << path << ": " << file_fs << "Hz"
+                  << std::endl;
+        continue;
+      }
+      std::uint64_t hash = worldline::HashBuffer(samples);
+      worldline::Model model(std::move(samples), fs, frame_ms,
+                             std::make_unique<worldline::PyinEstimator>());
+      model.BuildF0();
+      model.BuildSp();
+      model.BuildAp();
+      writer.Add(hash, model.samples().size(), model.f0(), model.ts(),
+                 model.sp(), model.ap());
+      baked++;
+    }
+  };
+  std::vector<std::thread> workers;
+  for (int i = 0; i < threads; ++i) {
+    workers.emplace_back(work);
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  if (!writer.Finish()) {
+    std::cout << "cannot write " << output << std::endl;
+    return 1;
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+  std::cout << "baked " << baked << "/" << wav_paths.size() << " files to "
+            << output << " in " << elapsed.count() << "ms" << std::endl;
+  return 0;
+}
@@ -29,6 +29,32 @@ struct SynthRequest {
   int flag_Mt;
   int flag_Mb;
   int flag_Mv;
+
+  // worldline::QualityTier of the analysis, 0 for final and 1 for preview.
+  // PhraseSynth uses its own tier for all notes instead.
+  std::int32_t quality = 0;
+  // MIDI tone the sample was recorded at, e.g. from the pitch label of its
+  // voicebank folder, or 0 if unknown. Narrows the pyin f0 search around it.
+  std::int32_t sample_tone = 0;
+  // Opt-in write-back: when the request has no frq, f0 of the whole sample
+  // is estimated once and written to this path as a frq file, normally
+  // <name>_wav.frq next to the sample, so that later runs of any UTAU tool
+  // read it instead. UTF-8, and null disables writing.
+  char* frq_write_path = 0;
+  // Handle returned by SampleStoreLoad, or 0. When set, the samples are read
+  // from the store in place of sample, which may be null. The handle may be
+  // released once the call taking the request returns. sample_fs and
+  // sample_length are still those of the stored sample.
+  std::int64_t sample_handle = 0;
+};
+
+// Placement of a request within a phrase.
+struct RequestTiming {
+  double pos_ms;
+  double skip_ms;
+  double length_ms;
+  double fade_in_ms;
+  double fade_out_ms;
 };
 
 struct SynthOutput {
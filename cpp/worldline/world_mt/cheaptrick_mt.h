@@ -0,0 +1,18 @@
+#ifndef WORLDLINE_WORLD_MT_CHEAPTRICK_MT_H_
+#define WORLDLINE_WORLD_MT_CHEAPTRICK_MT_H_
+
+#include "world/cheaptrick.h"
+#include "worldline/common/thread_pool.h"
+
+//-----------------------------------------------------------------------------
+// CheapTrickMt() is CheapTrick() with frames split into chunks that run on
+// pool. The infinitesimal noise of each frame is seeded from its index, so
+// the result is the same for any pool size, including one without workers.
+// Input and output are the same as CheapTrick().
+//-----------------------------------------------------------------------------
+void CheapTrickMt(const double *x, int x_length, int fs,
+    const double *temporal_positions, const double *f0, int f0_length,
+    const CheapTrickOption *option, double **spectrogram,
+    worldline::ThreadPool *pool);
+
+#endif  // WORLDLINE_WORLD_MT_CHEAPTRICK_MT_H_
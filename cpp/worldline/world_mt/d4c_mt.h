@@ -0,0 +1,18 @@
+#ifndef WORLDLINE_WORLD_MT_D4C_MT_H_
+#define WORLDLINE_WORLD_MT_D4C_MT_H_
+
+#include "world/d4c.h"
+#include "worldline/common/thread_pool.h"
+
+//-----------------------------------------------------------------------------
+// D4CMt() is D4C() with frames split into chunks that run on pool. The
+// infinitesimal noise of each frame is seeded from its index, so the result
+// is the same for any pool size, including one without workers.
+// Input and output are the same as D4C().
+//-----------------------------------------------------------------------------
+void D4CMt(const double *x, int x_length, int fs,
+    const double *temporal_positions, const double *f0, int f0_length,
+    int fft_size, const D4COption *option, double **aperiodicity,
+    worldline::ThreadPool *pool);
+
+#endif  // WORLDLINE_WORLD_MT_D4C_MT_H_
@@ -0,0 +1,53 @@
+#ifndef WORLDLINE_WORLD_MT_FRAME_RANDN_H_
+#define WORLDLINE_WORLD_MT_FRAME_RANDN_H_
+
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// FrameRandn is randn() of WORLD with its own state. It is seeded from the
+// index of a frame or pulse, so the noise of a frame does not depend on which
+// frames were processed before it, nor on which thread.
+//-----------------------------------------------------------------------------
+class FrameRandn {
+ public:
+  explicit FrameRandn(int index) {
+    // Spreads the index over the whole state with splitmix64, since nearby
+    // indices differing in x alone give correlated, under-scaled first draws.
+    uint64_t state = 0x2545f4914f6cdd1dull + static_cast<uint32_t>(index);
+    uint64_t a = SplitMix64(&state);
+    uint64_t b = SplitMix64(&state);
+    x_ = static_cast<uint32_t>(a);
+    y_ = static_cast<uint32_t>(a >> 32);
+    z_ = static_cast<uint32_t>(b);
+    // xorshift128 needs a non-zero state.
+    w_ = static_cast<uint32_t>(b >> 32) | 1;
+  }
+
+  double operator()() {
+    uint32_t tmp = 0;
+    for (int i = 0; i < 12; ++i) {
+      uint32_t t = x_ ^ (x_ << 11);
+      x_ = y_;
+      y_ = z_;
+      z_ = w_;
+      w_ = (w_ ^ (w_ >> 19)) ^ (t ^ (t >> 8));
+      tmp += w_ >> 4;
+    }
+    return tmp / 268435456.0 - 6.0;
+  }
+
+ private:
+  static uint64_t SplitMix64(uint64_t* state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+
+  uint32_t x_;
+  uint32_t y_;
+  uint32_t z_;
+  uint32_t w_;
+};
+
+#endif  // WORLDLINE_WORLD_MT_FRAME_RANDN_H_
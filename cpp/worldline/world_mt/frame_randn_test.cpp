@@ -0,0 +1,51 @@
+#include "worldline/world_mt/frame_randn.h"
+
+#include <cmath>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+// Draws of randn() sum 12 uniforms, so they have mean 0 and variance 1.
+void ExpectStandard(double sum, double sum_squares, int count) {
+  double mean = sum / count;
+  double variance = sum_squares / count - mean * mean;
+  EXPECT_NEAR(mean, 0, 0.03);
+  EXPECT_NEAR(variance, 1, 0.05);
+}
+
+TEST(FrameRandnTest, FirstDrawsAcrossIndicesAreStandard) {
+  constexpr int kCount = 20000;
+  double sum = 0;
+  double sum_squares = 0;
+  for (int i = 0; i < kCount; ++i) {
+    double x = FrameRandn(i)();
+    sum += x;
+    sum_squares += x * x;
+  }
+  ExpectStandard(sum, sum_squares, kCount);
+}
+
+TEST(FrameRandnTest, DrawsOfOneIndexAreStandard) {
+  constexpr int kCount = 20000;
+  FrameRandn randn(7);
+  double sum = 0;
+  double sum_squares = 0;
+  for (int i = 0; i < kCount; ++i) {
+    double x = randn();
+    sum += x;
+    sum_squares += x * x;
+  }
+  ExpectStandard(sum, sum_squares, kCount);
+}
+
+TEST(FrameRandnTest, DependsOnlyOnIndex) {
+  FrameRandn a(42);
+  FrameRandn b(42);
+  FrameRandn c(43);
+  double first = a();
+  EXPECT_EQ(first, b());
+  EXPECT_NE(first, c());
+}
+
+}  // namespace
@@ -0,0 +1,91 @@
+#ifndef WORLDLINE_WORLD_MT_SYNTHESIS_MT_H_
+#define WORLDLINE_WORLD_MT_SYNTHESIS_MT_H_
+
+#include <vector>
+
+#include "world/synthesis.h"
+#include "worldline/common/thread_pool.h"
+
+//-----------------------------------------------------------------------------
+// SynthesisMt() is the patched Synthesis() with pulses split into chunks that
+// run on pool. Each chunk overlap-adds into its own buffer, and the buffers
+// are summed in chunk order. The noise of each pulse is seeded from its
+// index, so the result is the same for any pool size, including one without
+// workers. Input and output are the same as Synthesis(), except for tension:
+// instead of an envelope per frame, tension is the value of each frame in
+// [-100, 100], and the envelope of GetCachedTensionCoefficients() is looked
+// up from it and tension_f0 for the pulses that need it. tension may be NULL.
+//-----------------------------------------------------------------------------
+void SynthesisMt(const double *f0, int f0_length,
+    const double * const *spectrogram, const double * const *aperiodicity,
+    int fft_size, double frame_period, int fs,
+    const double *tension, const double *tension_f0,
+    const double *breathiness, const double *voicing,
+    int y_length, double *y, worldline::ThreadPool *pool);
+
+//-----------------------------------------------------------------------------
+// SynthesisStream synthesizes the same signal as SynthesisMt() a few chunks
+// of pulses at a time, so that the beginning can be played while the rest is
+// being synthesized. Samples are final once no later pulse overlaps them.
+// Only the row pointers are copied, the rows and the tension, breathiness and
+// voicing arrays must outlive the stream.
+//-----------------------------------------------------------------------------
+class SynthesisStream {
+ public:
+  SynthesisStream(const double *f0, int f0_length,
+      const double * const *spectrogram, const double * const *aperiodicity,
+      int fft_size, double frame_period, int fs,
+      const double *tension, const double *tension_f0,
+      const double *breathiness, const double *voicing, int y_length,
+      worldline::ThreadPool *pool);
+
+  int y_length() const { return y_length_; }
+  int position() const { return position_; }
+
+  // Writes the next samples to y, at most length, and returns how many were
+  // written. Returns 0 once all y_length samples have been read.
+  int Read(double *y, int length);
+  // Restarts the stream so that Read returns samples [begin, end) only. Only
+  // the pulses overlapping them are synthesized, and the samples are the
+  // same as when read from the start.
+  void Seek(int begin, int end);
+
+ private:
+  int ChunkOffset(int chunk) const;
+  void SynthesizeChunk(int chunk, std::vector<double> *output) const;
+  // Synthesizes chunks until samples before target are final.
+  void SynthesizeUntil(int target);
+
+  int f0_length_;
+  std::vector<const double *> spectrogram_;
+  std::vector<const double *> aperiodicity_;
+  int fft_size_;
+  double frame_period_;
+  int fs_;
+  const double *tension_;
+  const double *tension_f0_;
+  const double *breathiness_;
+  const double *voicing_;
+  int y_length_;
+  worldline::ThreadPool *pool_;
+
+  std::vector<double> pulse_locations_;
+  std::vector<int> pulse_locations_index_;
+  std::vector<double> pulse_locations_time_shift_;
+  std::vector<double> interpolated_vuv_;
+  std::vector<double> dc_remover_;
+  int number_of_pulses_;
+  int chunks_;
+
+  int next_chunk_ = 0;
+  // Read stops here.
+  int end_;
+  // Samples before final_ will not change anymore.
+  int final_;
+  int position_ = 0;
+  // Sum of the synthesized chunks from sample pending_start_ on.
+  std::vector<double> pending_;
+  int pending_start_ = 0;
+};
+
+#endif  // WORLDLINE_WORLD_MT_SYNTHESIS_MT_H_
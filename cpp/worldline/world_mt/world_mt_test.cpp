@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "world/cheaptrick.h"
+#include "world/d4c.h"
+#include "worldline/common/frame_matrix.h"
+#include "worldline/common/thread_pool.h"
+#include "worldline/world_mt/cheaptrick_mt.h"
+#include "worldline/world_mt/d4c_mt.h"
+#include "worldline/world_mt/synthesis_mt.h"
+
+namespace worldline {
+namespace {
+
+constexpr int kFs = 44100;
+constexpr int kFrames = 100;
+constexpr double kPi = 3.14159265358979323846;
+
+class WorldMtTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    for (int i = 0; i < kFs; ++i) {
+      double t = static_cast<double>(i) / kFs;
+      x_.push_back(0.5 * std::sin(2 * kPi * 220 * t) +
+                   0.1 * std::sin(2 * kPi * 1234 * t * t));
+    }
+    for (int i = 0; i < kFrames; ++i) {
+      ts_.push_back(i * 0.01);
+      // Unvoiced frames in between.
+      f0_.push_back(i % 10 < 7 ? 200 + i : 0);
+    }
+  }
+
+  std::vector<double> x_;
+  std::vector<double> ts_;
+  std::vector<double> f0_;
+};
+
+void ExpectIdentical(const FrameMatrix& a, const FrameMatrix& b) {
+  ASSERT_EQ(a.rows(), b.rows());
+  for (int i = 0; i < a.rows(); ++i) {
+    for (int j = 0; j < a.width(); ++j) {
+      ASSERT_EQ(a[i][j], b[i][j]) << i << ", " << j;
+    }
+  }
+}
+
+TEST_F(WorldMtTest, CheapTrickDoesNotDependOnThreads) {
+  CheapTrickOption option;
+  InitializeCheapTrickOption(kFs, &option);
+  FrameMatrix serial(kFrames, option.fft_size / 2 + 1);
+  FrameMatrix parallel(kFrames, option.fft_size / 2 + 1);
+  std::vector<double*> serial_rows = serial.RowPointers();
+  std::vector<double*> parallel_rows = parallel.RowPointers();
+  ThreadPool serial_pool(0);
+  ThreadPool parallel_pool(4);
+  CheapTrickMt(x_.data(), x_.size(), kFs, ts_.data(), f0_.data(), kFrames,
+               &option, serial_rows.data(), &serial_pool);
+  CheapTrickMt(x_.data(), x_.size(), kFs, ts_.data(), f0_.data(), kFrames,
+               &option, parallel_rows.data(), &parallel_pool);
+  ExpectIdentical(serial, parallel);
+  EXPECT_GT(serial[0][10], 0);
+}
+
+TEST_F(WorldMtTest, D4CDoesNotDependOnThreads) {
+  constexpr int kFftSize = 2048;
+  D4COption option;
+  InitializeD4COption(&option);
+  option.threshold = 0;
+  FrameMatrix serial(kFrames, kFftSize / 2 + 1);
+  FrameMatrix parallel(kFrames, kFftSize / 2 + 1);
+  std::vector<double*> serial_rows = serial.RowPointers();
+  std::vector<double*> parallel_rows = parallel.RowPointers();
+  ThreadPool serial_pool(0);
+  ThreadPool parallel_pool(4);
+  D4CMt(x_.data(), x_.size(), kFs, ts_.data(), f0_.data(), kFrames, kFftSize,
+        &option, serial_rows.data(), &serial_pool);
+  D4CMt(x_.data(), x_.size(), kFs, ts_.data(), f0_.data(), kFrames, kFftSize,
+        &option, parallel_rows.data(), &parallel_pool);
+  ExpectIdentical(serial, parallel);
+  // Unvoiced frames are fully aperiodic.
+  EXPECT_NEAR(serial[8][100], 1, 1e-9);
+}
+
+TEST_F(WorldMtTest, SynthesisDoesNotDependOnThreads) {
+  constexpr int kFftSize = 2048;
+  constexpr int kWidth = kFftSize / 2 + 1;
+  FrameMatrix sp(kFrames, kWidth);
+  FrameMatrix ap(kFrames, kWidth);
+  for (int i = 0; i < kFrames; ++i) {
+    for (int j = 0; j < kWidth; ++j) {
+      sp[i][j] = 1e-3 / (1 + j * 0.01);
+      ap[i][j] = std::min(0.99, 0.01 + j * 0.001);
+    }
+  }
+  // Neutral and shaped tension, alternating.
+  std::vector<double> tension(kFrames);
+  for (int i = 0; i < kFrames; ++i) {
+    tension[i] = i % 20 < 10 ? 0 : 40;
+  }
+  std::vector<double> breathiness(kFrames, 1);
+  std::vector<double> voicing(kFrames, 1);
+  std::vector<const double*> sp_rows = sp.ConstRowPointers();
+  std::vector<const double*> ap_rows = ap.ConstRowPointers();
+
+  int y_length = static_cast<int>(kFs * (kFrames - 1) * 0.01) + 1;
+  std::vector<double> serial(y_length);
+  std::vector<double> parallel(y_length);
+  ThreadPool serial_pool(0);
+  ThreadPool parallel_pool(4);
+  SynthesisMt(f0_.data(), kFrames, sp_rows.data(), ap_rows.data(), kFftSize,
+              10, kFs, tension.data(), f0_.data(), breathiness.data(),
+              voicing.data(), y_length, serial.data(), &serial_pool);
+  SynthesisMt(f0_.data(), kFrames, sp_rows.data(), ap_rows.data(), kFftSize,
+              10, kFs, tension.data(), f0_.data(), breathiness.data(),
+              voicing.data(), y_length, parallel.data(), &parallel_pool);
+  double energy = 0;
+  for (int i = 0; i < y_length; ++i) {
+    ASSERT_EQ(serial[i], parallel[i]) << i;
+    energy += serial[i] * serial[i];
+  }
+  EXPECT_GT(energy, 0);
+
+  // Streaming gives the same samples, whatever the block size.
+  SynthesisStream stream(f0_.data(), kFrames, sp_rows.data(), ap_rows.data(),
+                         kFftSize, 10, kFs, tension.data(), f0_.data(),
+                         breathiness.data(), voicing.data(), y_length,
+                         &parallel_pool);
+  std::vector<double> streamed(y_length);
+  for (int block = 1, read = 0; read < y_length; block = block * 3 + 1) {
+    int count = stream.Read(streamed.data() + read, block);
+    ASSERT_GT(count, 0);
+    read += count;
+  }
+  EXPECT_EQ(stream.Read(streamed.data(), 1), 0);
+  for (int i = 0; i < y_length; ++i) {
+    ASSERT_EQ(serial[i], streamed[i]) << i;
+  }
+
+  // So does a range read after seeking, even backwards.
+  int begin = y_length / 3;
+  int end = y_length / 2;
+  stream.Seek(begin, end);
+  std::vector<double> range(end - begin);
+  for (int read = 0; read < end - begin;) {
+    int count = stream.Read(range.data() + read, end - begin - read);
+    ASSERT_GT(count, 0);
+    read += count;
+  }
+  EXPECT_EQ(stream.Read(range.data(), 1), 0);
+  for (int i = begin; i < end; ++i) {
+    ASSERT_EQ(serial[i], range[i - begin]) << i;
+  }
+}
+
+}  // namespace
+}  // namespace worldline
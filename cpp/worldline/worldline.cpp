@@ -10,13 +10,20 @@
 #include "world/dio.h"
 #include "world/synthesis.h"
 #include "worldline/classic/resampler.h"
-#include "worldline/common/vec_utils.h"
+#include "worldline/common/thread_pool.h"
 #include "worldline/f0/dio_estimator.h"
 #include "worldline/f0/dio_ss_estimator.h"
 #include "worldline/f0/f0_estimator.h"
 #include "worldline/f0/harvest_estimator.h"
 #include "worldline/f0/pyin_estimator.h"
+#include "worldline/model/analysis_cache.h"
 #include "worldline/model/effects.h"
+#include "worldline/model/feature_store.h"
+#include "worldline/model/model.h"
+#include "worldline/model/sample_store.h"
+#include "worldline/world_mt/cheaptrick_mt.h"
+#include "worldline/world_mt/d4c_mt.h"
+#include "worldline/world_mt/synthesis_mt.h"
 
 static double** to2d(double* const arr, int length, int width) {
   double** arr2d = new double*[length];
@@ -109,10 +116,9 @@ DLL_API void WorldAnalysis(const AnalysisConfig* config, float* samples,
   *ap_out = new double[*num_frames * sp_size];
   std::copy(model.f0().begin(), model.f0().end(), *f0_out);
   for (int i = 0; i < *num_frames; ++i) {
-    std::copy(model.sp()[i].begin(), model.sp()[i].end(),
+    std::copy(model.sp()[i], model.sp()[i] + sp_size,
               *sp_env_out + i * sp_size);
-    std::copy(model.ap()[i].begin(), model.ap()[i].end(),
-              *ap_out + i * sp_size);
+    std::copy(model.ap()[i], model.ap()[i] + sp_size, *ap_out + i * sp_size);
   }
 }
 
@@ -136,14 +142,16 @@ DLL_API void WorldAnalysisF0In(const AnalysisConfig* config, float* samples,
   InitializeCheapTrickOption(config->fs, &ct_option);
   ct_option.f0_floor = config->f0_floor;
   ct_option.fft_size = config->fft_size;
-  CheapTrick(samples_vec.data(), samples_vec.size(), config->fs, ts_vec.data(),
-             f0_in, num_frames, &ct_option, sp_env_2d);
+  CheapTrickMt(samples_vec.data(), samples_vec.size(), config->fs,
+               ts_vec.data(), f0_in, num_frames, &ct_option, sp_env_2d,
+               &worldline::ThreadPool::Global());
 
   D4COption d4c_option;
   InitializeD4COption(&d4c_option);
   // d4c_option.threshold = 0;
-  D4C(samples_vec.data(), samples_vec.size(), config->fs, ts_vec.data(), f0_in,
-      num_frames, config->fft_size, &d4c_option, ap_2d);
+  D4CMt(samples_vec.data(), samples_vec.size(), config->fs, ts_vec.data(),
+        f0_in, num_frames, config->fft_size, &d4c_option, ap_2d,
+        &worldline::ThreadPool::Global());
 
   delete[] sp_env_2d;
   delete[] ap_2d;
@@ -190,16 +198,16 @@ DLL_API int WorldSynthesis(double* const f0, int f0_length,
 
   if (gender != nullptr) {
     for (int i = 0; i < f0_length; ++i) {
-      worldline::ShiftGender(sp[i], sp_size, (gender[i] - 0.5) * 200);
+      if (gender[i] != 0.5) {
+        worldline::ShiftGender(sp[i], sp_size, (gender[i] - 0.5) * 200);
+      }
     }
   }
 
-  std::vector<std::vector<double>> ten =
-      worldline::vec2d(sp_size, f0_length, 1);
+  std::vector<double> ten(f0_length, 0);
   if (tension != nullptr) {
     for (int i = 0; i < f0_length; ++i) {
-      ten[i] = worldline::GetTensionCoefficients(
-          f0[i], fs, (tension[i] - 0.5) * 200, sp_size);
+      ten[i] = (tension[i] - 0.5) * 200;
     }
   }
 
@@ -217,9 +225,9 @@ DLL_API int WorldSynthesis(double* const f0, int f0_length,
     }
   }
 
-  auto ten_wrapper = worldline::vec2d_wrapper(ten);
-  Synthesis(f0, f0_length, sp, ap, fft_size, frame_period, fs,
-            ten_wrapper.data(), bre.data(), voi.data(), y_length, *y);
+  SynthesisMt(f0, f0_length, sp, ap, fft_size, frame_period, fs, ten.data(),
+              f0, bre.data(), voi.data(), y_length, *y,
+              &worldline::ThreadPool::Global());
 
   if (is_mgc) {
     for (int i = 0; i < f0_length; ++i) {
@@ -248,17 +256,56 @@ DLL_API int Resample(const SynthRequest* request, float** y) {
 
 DLL_API PhraseSynth* PhraseSynthNew() { return new PhraseSynth(); }
 
+DLL_API PhraseSynth* PhraseSynthNewFolding() {
+  return new PhraseSynth(/*fold_on_add=*/true);
+}
+
 DLL_API void PhraseSynthDelete(PhraseSynth* phrase_synth) {
   delete phrase_synth;
 }
 
-DLL_API void PhraseSynthAddRequest(PhraseSynth* phrase_synth,
-                                   const SynthRequest* request, double pos_ms,
-                                   double skip_ms, double length_ms,
-                                   double fade_in_ms, double fade_out_ms,
+DLL_API int PhraseSynthSetQuality(PhraseSynth* phrase_synth, int quality,
+                                  int upgrade) {
+  if (quality != static_cast<int>(worldline::QualityTier::kFinal) &&
+      quality != static_cast<int>(worldline::QualityTier::kPreview)) {
+    return 0;
+  }
+  return phrase_synth->SetQuality(
+             static_cast<worldline::QualityTier>(quality), upgrade != 0)
+             ? 1
+             : 0;
+}
+
+DLL_API int PhraseSynthAddRequest(PhraseSynth* phrase_synth,
+                                  const SynthRequest* request, double pos_ms,
+                                  double skip_ms, double length_ms,
+                                  double fade_in_ms, double fade_out_ms,
+                                  worldline::LogCallback logCallback) {
+  return phrase_synth->AddRequest(*request, pos_ms, skip_ms, length_ms,
+                                  fade_in_ms, fade_out_ms, logCallback);
+}
+
+DLL_API int PhraseSynthAddRequests(PhraseSynth* phrase_synth,
+                                   const SynthRequest* requests,
+                                   const RequestTiming* timings, int count,
                                    worldline::LogCallback logCallback) {
-  phrase_synth->AddRequest(*request, pos_ms, skip_ms, length_ms, fade_in_ms,
-                           fade_out_ms, logCallback);
+  return phrase_synth->AddRequests(requests, timings, count, logCallback);
+}
+
+DLL_API int PhraseSynthReplaceRequest(PhraseSynth* phrase_synth, int id,
+                                      const SynthRequest* request,
+                                      const RequestTiming* timing,
+                                      worldline::LogCallback logCallback) {
+  return phrase_synth->ReplaceRequest(id, *request, *timing, logCallback);
+}
+
+DLL_API int PhraseSynthRemoveRequest(PhraseSynth* phrase_synth, int id) {
+  return phrase_synth->RemoveRequest(id);
+}
+
+DLL_API int PhraseSynthUpdateTiming(PhraseSynth* phrase_synth, int id,
+                                    const RequestTiming* timing) {
+  return phrase_synth->UpdateTiming(id, *timing);
 }
 
 DLL_API void PhraseSynthSetCurves(PhraseSynth* phrase_synth, double* f0,
@@ -278,3 +325,79 @@ DLL_API int PhraseSynthSynth(PhraseSynth* phrase_synth, float** y,
   std::copy(samples.begin(), samples.end(), *y);
   return yLength;
 }
+
+DLL_API int PhraseSynthBeginStream(PhraseSynth* phrase_synth,
+                                   worldline::LogCallback logCallback) {
+  return phrase_synth->BeginStream(logCallback);
+}
+
+DLL_API int PhraseSynthRead(PhraseSynth* phrase_synth, float* buf, int n) {
+  return phrase_synth->Read(buf, n);
+}
+
+DLL_API void PhraseSynthGetMemoryStats(PhraseSynth* phrase_synth,
+                                       PhraseSynthMemoryStats* stats) {
+  PhraseSynth::MemoryStats memory_stats = phrase_synth->GetMemoryStats();
+  stats->bytes = memory_stats.bytes;
+  stats->peak_bytes = memory_stats.peak_bytes;
+  stats->cache_bytes = memory_stats.cache_bytes;
+  stats->pool_bytes = memory_stats.pool_bytes;
+  stats->pending_upgrades = memory_stats.pending_upgrades;
+  stats->upgrade_bytes = memory_stats.upgrade_bytes;
+}
+
+DLL_API void AnalysisCacheSetBudget(std::int64_t budget_bytes) {
+  worldline::AnalysisCache::Global().SetBudget(
+      static_cast<std::size_t>(std::max<std::int64_t>(0, budget_bytes)));
+}
+
+DLL_API void AnalysisCacheGetStats(AnalysisCacheStats* stats) {
+  worldline::AnalysisCache::Stats cache_stats =
+      worldline::AnalysisCache::Global().GetStats();
+  stats->hits = cache_stats.hits;
+  stats->misses = cache_stats.misses;
+  stats->evictions = cache_stats.evictions;
+  stats->entries = cache_stats.entries;
+  stats->bytes = cache_stats.bytes;
+  stats->budget_bytes = cache_stats.budget_bytes;
+}
+
+DLL_API void AnalysisCacheClear() {
+  worldline::AnalysisCache::Global().Clear();
+}
+
+DLL_API void F0SetPyinMethod(int method) {
+  worldline::SetPyinMethod(method == 1 ? worldline::PyinMethod::kFft
+                                       : worldline::PyinMethod::kLibpyin);
+}
+
+DLL_API int FeatureStoreMount(const char* path) {
+  auto store = worldline::FeatureStore::Open(path);
+  if (store == nullptr) {
+    return 0;
+  }
+  worldline::FeatureStore::Mount(std::move(store));
+  return 1;
+}
+
+DLL_API void FeatureStoreUnmountAll() { worldline::FeatureStore::UnmountAll(); }
+
+DLL_API std::int64_t SampleStoreLoad(const char* path, int* fs, int* length) {
+  worldline::SampleStore& store = worldline::SampleStore::Global();
+  std::int64_t handle = store.Load(path);
+  auto sample = store.Get(handle);
+  if (sample == nullptr) {
+    return 0;
+  }
+  *fs = sample->fs;
+  *length = sample->samples.size();
+  return handle;
+}
+
+DLL_API int SampleStoreRetain(std::int64_t handle) {
+  return worldline::SampleStore::Global().Retain(handle) ? 1 : 0;
+}
+
+DLL_API void SampleStoreRelease(std::int64_t handle) {
+  worldline::SampleStore::Global().Release(handle);
+}
@@ -1,6 +1,8 @@
 #ifndef WORLDLINE_WORLDLINE_H_
 #define WORLDLINE_WORLDLINE_H_
 
+#include <cstdint>
+
 #include "world/common.h"
 #include "world/constantnumbers.h"
 #include "world/matlabfunctions.h"
@@ -61,14 +63,48 @@ DLL_API int Resample(const SynthRequest* request, float** y);
 
 DLL_API PhraseSynth* PhraseSynthNew();
 
+// Same as PhraseSynthNew, but notes are folded into the phrase as they are
+// added and their analysis is freed. Bounds memory by the phrase length, at
+// the cost of PhraseSynthReplaceRequest, PhraseSynthRemoveRequest and
+// PhraseSynthUpdateTiming, which then always fail.
+DLL_API PhraseSynth* PhraseSynthNewFolding();
+
 DLL_API void PhraseSynthDelete(PhraseSynth* phrase_synth);
 
-DLL_API void PhraseSynthAddRequest(PhraseSynth* phrase_synth,
-                                   const SynthRequest* request, double pos_ms,
-                                   double skip_ms, double length_ms,
-                                   double fade_in_ms, double fade_out_ms,
+// Sets the analysis quality of all notes, 0 for final and 1 for preview.
+// With upgrade non-zero, preview notes are also analyzed at final quality in
+// the background to fill the analysis cache. Must be called before adding
+// requests. Returns 1 on success and 0 otherwise.
+DLL_API int PhraseSynthSetQuality(PhraseSynth* phrase_synth, int quality,
+                                  int upgrade);
+
+// Returns the id of the request.
+DLL_API int PhraseSynthAddRequest(PhraseSynth* phrase_synth,
+                                  const SynthRequest* request, double pos_ms,
+                                  double skip_ms, double length_ms,
+                                  double fade_in_ms, double fade_out_ms,
+                                  worldline::LogCallback logCallback);
+
+// Adds count requests at once, analyzing them in parallel. Same result as
+// calling PhraseSynthAddRequest for each in order. Returns the id of the
+// first request, the others follow consecutively.
+DLL_API int PhraseSynthAddRequests(PhraseSynth* phrase_synth,
+                                   const SynthRequest* requests,
+                                   const RequestTiming* timings, int count,
                                    worldline::LogCallback logCallback);
 
+// Edit the request with the given id, keeping the analysis of the others.
+// Return 1 on success, or 0 if there is no such request.
+DLL_API int PhraseSynthReplaceRequest(PhraseSynth* phrase_synth, int id,
+                                      const SynthRequest* request,
+                                      const RequestTiming* timing,
+                                      worldline::LogCallback logCallback);
+
+DLL_API int PhraseSynthRemoveRequest(PhraseSynth* phrase_synth, int id);
+
+DLL_API int PhraseSynthUpdateTiming(PhraseSynth* phrase_synth, int id,
+                                    const RequestTiming* timing);
+
 DLL_API void PhraseSynthSetCurves(PhraseSynth* phrase_synth, double* f0,
                                   double* gender, double* tension,
                                   double* breathiness, double* voicing,
@@ -77,6 +113,71 @@ DLL_API void PhraseSynthSetCurves(PhraseSynth* phrase_synth, double* f0,
 
 DLL_API int PhraseSynthSynth(PhraseSynth* phrase_synth, float** y,
                              worldline::LogCallback logCallback);
+
+// Starts synthesizing the phrase in the background of PhraseSynthRead calls.
+// Returns the total number of samples.
+DLL_API int PhraseSynthBeginStream(PhraseSynth* phrase_synth,
+                                   worldline::LogCallback logCallback);
+
+// Copies the next at most n samples of the stream into buf. Returns the
+// number of samples copied, or 0 when the stream has ended.
+DLL_API int PhraseSynthRead(PhraseSynth* phrase_synth, float* buf, int n);
+
+// See PhraseSynth::MemoryStats. cache_bytes, pool_bytes, pending_upgrades
+// and upgrade_bytes are process-wide.
+struct PhraseSynthMemoryStats {
+  std::int64_t bytes;
+  std::int64_t peak_bytes;
+  std::int64_t cache_bytes;
+  std::int64_t pool_bytes;
+  std::int64_t pending_upgrades;
+  std::int64_t upgrade_bytes;
+};
+
+DLL_API void PhraseSynthGetMemoryStats(PhraseSynth* phrase_synth,
+                                       PhraseSynthMemoryStats* stats);
+
+struct AnalysisCacheStats {
+  std::int64_t hits;
+  std::int64_t misses;
+  std::int64_t evictions;
+  std::int64_t entries;
+  std::int64_t bytes;
+  std::int64_t budget_bytes;
+};
+
+// Sets the memory budget of the process-wide f0/sp/ap analysis cache.
+// 0 disables the cache.
+DLL_API void AnalysisCacheSetBudget(std::int64_t budget_bytes);
+
+DLL_API void AnalysisCacheGetStats(AnalysisCacheStats* stats);
+
+DLL_API void AnalysisCacheClear();
+
+// Picks the pyin implementation estimating f0 of samples without a frq
+// file: 0 for libpyin, the default, and 1 for the FFT-based one, see
+// worldline::PyinMethod. Applies to the whole process.
+DLL_API void F0SetPyinMethod(int method);
+
+// Memory-maps a feature store written by //worldline:prebake. Samples found
+// in mounted stores skip f0/sp/ap analysis. Returns 1 on success.
+DLL_API int FeatureStoreMount(const char* path);
+
+DLL_API void FeatureStoreUnmountAll();
+
+// Decodes the wav file at path, UTF-8, once for all requests referring to
+// it by SynthRequest::sample_handle, and sets its fs and length in samples.
+// Loading an unchanged file again returns the same handle with one more
+// reference. Returns 0 if the file cannot be read.
+DLL_API std::int64_t SampleStoreLoad(const char* path, int* fs, int* length);
+
+// Takes another reference to a loaded handle, without looking its file up
+// again. Returns 1, or 0 if the handle was released.
+DLL_API int SampleStoreRetain(std::int64_t handle);
+
+// Drops a reference taken by SampleStoreLoad or SampleStoreRetain. The samples
+// are freed with the last one, once no analysis reads them.
+DLL_API void SampleStoreRelease(std::int64_t handle);
 }
 
 #endif  // WORLDLINE_WORLDLINE_H_
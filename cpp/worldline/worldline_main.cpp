@@ -1,55 +1,231 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <optional>
 #include <string>
+#include <system_error>
 #include <vector>
 
 #include "absl/debugging/failure_signal_handler.h"
 #include "absl/debugging/symbolize.h"
 #include "absl/strings/str_join.h"
-#include "audioio.h"
 #include "world/synthesis.h"
+#include "worldline/classic/batch_file.h"
 #include "worldline/classic/resampler.h"
+#include "worldline/classic/sample_cache.h"
+#include "worldline/classic/server.h"
+#include "worldline/common/wav_writer.h"
+#include "worldline/common/thread_pool.h"
+#include "worldline/model/feature_store.h"
 #include "worldline/model/effects.h"
+#include "worldline/model/model.h"
 #include "worldline/synth_request.h"
 
+// Renders the resampler calls of a UTAU temp.bat across all cores. Calls
+// differing only in their output are rendered once and copied.
+static int RenderBatch(const std::string& batch_path, bool write_frq) {
+  std::vector<std::vector<std::string>> calls =
+      worldline::ParseBatchFile(batch_path);
+  if (calls.empty()) {
+    std::cout << "no resampler calls found in " << batch_path << std::endl;
+    return 1;
+  }
+  std::vector<std::vector<std::string>> unique_calls;
+  std::vector<std::vector<std::string>> outputs;
+  std::map<std::vector<std::string>, int> index;
+  for (std::vector<std::string>& call : calls) {
+    if (call.size() < 2) {
+      continue;
+    }
+    std::vector<std::string> key = call;
+    key.erase(key.begin() + 1);
+    auto it = index.emplace(key, unique_calls.size()).first;
+    if (it->second == unique_calls.size()) {
+      unique_calls.push_back(call);
+      outputs.emplace_back();
+    }
+    std::vector<std::string>& paths = outputs[it->second];
+    if (std::find(paths.begin(), paths.end(), call[1]) == paths.end()) {
+      paths.push_back(call[1]);
+    }
+  }
+  for (const auto& paths : outputs) {
+    for (const std::string& path : paths) {
+      std::error_code error;
+      std::filesystem::create_directories(
+          std::filesystem::path(path).parent_path(), error);
+    }
+  }
+
+  worldline::SampleCache cache;
+  std::vector<std::string> errors(unique_calls.size());
+  auto start = std::chrono::steady_clock::now();
+  worldline::ThreadPool::Global().ParallelFor(
+      unique_calls.size(), [&](int i) {
+        errors[i] =
+            worldline::RenderClassic(unique_calls[i], &cache, write_frq);
+        for (int j = 1; j < outputs[i].size() && errors[i].empty(); ++j) {
+          std::error_code error;
+          std::filesystem::copy_file(
+              outputs[i][0], outputs[i][j],
+              std::filesystem::copy_options::overwrite_existing, error);
+          if (error) {
+            errors[i] = "cannot write " + outputs[i][j];
+          }
+        }
+      });
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+  int failed = 0;
+  for (int i = 0; i < errors.size(); ++i) {
+    if (!errors[i].empty()) {
+      std::cout << "failed " << unique_calls[i][0] << ": " << errors[i]
+                << std::endl;
+      failed++;
+    }
+  }
+  std::cout << "rendered " << unique_calls.size() - failed << "/"
+            << unique_calls.size() << " unique of " << calls.size()
+            << " calls in " << elapsed.count() << "ms" << std::endl;
+  return failed > 0 ? 1 : 0;
+}
+
 int main(int argc, char** argv) {
   absl::InitializeSymbolizer(argv[0]);
   absl::FailureSignalHandlerOptions options;
   absl::InstallFailureSignalHandler(options);
 
   bool debug = false;
+  // Writes f0 of samples without a frq file to one.
+  bool write_frq = false;
+  bool server = false;
+  std::string batch_path;
+  std::string socket_path;
+  worldline::ServerOptions server_options;
+  // Each render also fans its analysis out to the thread pool.
+  server_options.jobs = 2;
   std::string exe_path = std::string(argv[0]);
   std::vector<std::string> args;
   for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if (arg == "--write_frq") {
+      write_frq = true;
+      continue;
+    }
+    if (arg == "--pyin_fft") {
+      worldline::SetPyinMethod(worldline::PyinMethod::kFft);
+      continue;
+    }
+    if (arg == "--batch" && i + 1 < argc) {
+      batch_path = argv[++i];
+      continue;
+    }
+    if (arg == "--server") {
+      server = true;
+      continue;
+    }
+    if (arg.rfind("--socket=", 0) == 0) {
+      server = true;
+      socket_path = arg.substr(9);
+      continue;
+    }
+    if (arg == "--json") {
+      server_options.json = true;
+      continue;
+    }
+    if (arg.rfind("--jobs=", 0) == 0) {
+      server_options.jobs = std::atoi(arg.c_str() + 7);
+      continue;
+    }
     args.push_back(std::string(argv[i]));
     std::cout << i << " " << argv[i] << std::endl;
   }
 
+  if (!batch_path.empty()) {
+    return RenderBatch(batch_path, write_frq);
+  }
+
+  if (server) {
+    server_options.write_frq = write_frq;
+    worldline::SampleCache cache;
+    if (!socket_path.empty()) {
+      if (!worldline::ServeUnixSocket(socket_path, server_options, &cache)) {
+        std::cerr << "cannot listen on " << socket_path << std::endl;
+        return 1;
+      }
+      return 0;
+    }
+    if (!worldline::ServeStdio(server_options, &cache)) {
+      std::cerr << "cannot redirect stdout" << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
   if (args.size() < 4) {
     std::cout << "Worldline v0.0.6 - StAkira" << std::endl;
     std::cout
-        << "args: <input wavfile> <output file> <pitch_percent> <velocity> "
+        << "args: [--write_frq] <input wavfile> <output file> <pitch_percent> "
+           "<velocity> "
            "[<flags> [<offset> <length_require> [<fixed length> [<end_blank> "
            "[<volume> [<modulation> [<pich bend>...]]]]]]]"
         << std::endl;
+    std::cout << "  or: [--write_frq] --server|--socket=<path> [--json] "
+                 "[--jobs=<n>]"
+              << std::endl;
+    std::cout << "  or: [--write_frq] --batch <temp.bat>" << std::endl;
     std::cout << "flags:" << std::endl;
     std::cout << "  P =86(0~100): peak compression" << std::endl;
     std::cout << "  g =0(-100~100): gender" << std::endl;
     std::cout << "  Mt=0(-100~100): tension" << std::endl;
     std::cout << "  Mb=0(-100~100): breathiness" << std::endl;
     std::cout << "  Mv=100(0~100): voicing" << std::endl;
+    std::cout << "options:" << std::endl;
+    std::cout << "  --write_frq: write <name>_wav.frq for samples without one"
+              << std::endl;
+    std::cout << "  --pyin_fft: estimate f0 with the FFT-based pyin instead "
+                 "of libpyin"
+              << std::endl;
+    std::cout << "  --batch: render the resampler calls of a batch file on "
+                 "all cores"
+              << std::endl;
+    std::cout << "  --server: render requests from stdin until it ends, see "
+                 "classic/server.h"
+              << std::endl;
+    std::cout << "  --socket=<path>: serve requests on a Unix socket instead"
+              << std::endl;
+    std::cout << "  --json: requests are JSON arrays of arguments, one per line"
+              << std::endl;
+    std::cout << "  --jobs=<n>: requests rendered at once, 2 by default"
+              << std::endl;
     return 0;
   }
   std::cout << "args: " << absl::StrJoin(args, " ") << std::endl;
 
-  auto resampler = std::make_unique<worldline::Resampler>(args);
+  std::filesystem::path store_path =
+      std::filesystem::path(args[0]).parent_path() /
+      worldline::kFeatureStoreFileName;
+  if (auto store = worldline::FeatureStore::Open(store_path.string())) {
+    worldline::FeatureStore::Mount(std::move(store));
+  }
+
+  auto resampler = worldline::Resampler::FromArgs(args, write_frq);
+  if (resampler == nullptr) {
+    return 1;
+  }
   auto y = resampler->Resample();
 
   std::string out_path =
       args.size() >= 2 ? args[1]
                        : args[0].substr(0, args[0].size() - 4) + ".out.wav";
   std::cout << "write output to " << out_path << std::endl;
-  wavwrite(y.data(), y.size(), 44100, 16, out_path.c_str());
+  if (!worldline::WriteWav(out_path, y, 44100)) {
+    std::cerr << "cannot write " << out_path << std::endl;
+    return 1;
+  }
+  return 0;
 }
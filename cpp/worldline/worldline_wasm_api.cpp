@@ -1,6 +1,7 @@
 #include <emscripten.h>
 #include <cstring>
 #include <cstdlib>
+#include <vector>
 
 #include "worldline/worldline.h"
 #include "worldline/synth_request.h"
@@ -229,6 +230,20 @@ PhraseSynthWrapper* worldline_phrase_synth_new() {
     return wrapper;
 }
 
+EMSCRIPTEN_KEEPALIVE
+PhraseSynthWrapper* worldline_phrase_synth_new_folding() {
+    PhraseSynthWrapper* wrapper = (PhraseSynthWrapper*)malloc(sizeof(PhraseSynthWrapper));
+    wrapper->ptr = PhraseSynthNewFolding();
+    return wrapper;
+}
+
+// quality: 0=final, 1=preview. Returns 1 on success, 0 once requests were added.
+EMSCRIPTEN_KEEPALIVE
+int worldline_phrase_synth_set_quality(PhraseSynthWrapper* wrapper, int quality, int upgrade) {
+    if (!wrapper || !wrapper->ptr) return 0;
+    return PhraseSynthSetQuality(wrapper->ptr, quality, upgrade);
+}
+
 EMSCRIPTEN_KEEPALIVE
 void worldline_phrase_synth_delete(PhraseSynthWrapper* wrapper) {
     if (wrapper && wrapper->ptr) {
@@ -237,24 +252,23 @@ void worldline_phrase_synth_delete(PhraseSynthWrapper* wrapper) {
     free(wrapper);
 }
 
-EMSCRIPTEN_KEEPALIVE
-void worldline_phrase_synth_add_request(
-    PhraseSynthWrapper* wrapper,
-    float* samples, int sample_len,
+// The float samples are widened into buffer, which has to outlive the
+// request. samples may be null when the request reads a sample handle.
+static SynthRequest MakePhraseRequest(
+    float* samples, std::vector<double>* buffer, int sample_len,
     int sample_rate,
     int tone,
     double velocity, double offset, double required_length,
     double consonant, double cut_off, double volume, double modulation, double tempo,
-    int flag_g, int flag_O, int flag_P, int flag_Mt, int flag_Mb, int flag_Mv,
-    double pos_ms, double skip_ms, double length_ms,
-    double fade_in_ms, double fade_out_ms
+    int flag_g, int flag_O, int flag_P, int flag_Mt, int flag_Mb, int flag_Mv
 ) {
-    if (!wrapper || !wrapper->ptr) return;
-    
     SynthRequest request = {};
     request.sample_fs = sample_rate;
     request.sample_length = sample_len;
-    request.sample = (double*)samples;
+    if (samples) {
+        buffer->assign(samples, samples + sample_len);
+        request.sample = buffer->data();
+    }
     request.tone = tone;
     request.con_vel = velocity;
     request.offset = offset;
@@ -270,8 +284,105 @@ void worldline_phrase_synth_add_request(
     request.flag_Mt = flag_Mt;
     request.flag_Mb = flag_Mb;
     request.flag_Mv = flag_Mv;
+    return request;
+}
+
+// Returns the id of the request, or -1.
+EMSCRIPTEN_KEEPALIVE
+int worldline_phrase_synth_add_request(
+    PhraseSynthWrapper* wrapper,
+    float* samples, int sample_len,
+    int sample_rate,
+    int tone,
+    double velocity, double offset, double required_length,
+    double consonant, double cut_off, double volume, double modulation, double tempo,
+    int flag_g, int flag_O, int flag_P, int flag_Mt, int flag_Mb, int flag_Mv,
+    double pos_ms, double skip_ms, double length_ms,
+    double fade_in_ms, double fade_out_ms
+) {
+    if (!wrapper || !wrapper->ptr) return -1;
+    
+    std::vector<double> buffer;
+    SynthRequest request = MakePhraseRequest(
+        samples, &buffer, sample_len, sample_rate, tone,
+        velocity, offset, required_length,
+        consonant, cut_off, volume, modulation, tempo,
+        flag_g, flag_O, flag_P, flag_Mt, flag_Mb, flag_Mv);
+    
+    return PhraseSynthAddRequest(wrapper->ptr, &request, pos_ms, skip_ms, length_ms, fade_in_ms, fade_out_ms, nullptr);
+}
+
+// Same as worldline_phrase_synth_add_request, with the samples of a handle
+// from worldline_sample_store_load.
+EMSCRIPTEN_KEEPALIVE
+int worldline_phrase_synth_add_stored_request(
+    PhraseSynthWrapper* wrapper,
+    double sample_handle, int sample_len,
+    int sample_rate,
+    int tone,
+    double velocity, double offset, double required_length,
+    double consonant, double cut_off, double volume, double modulation, double tempo,
+    int flag_g, int flag_O, int flag_P, int flag_Mt, int flag_Mb, int flag_Mv,
+    double pos_ms, double skip_ms, double length_ms,
+    double fade_in_ms, double fade_out_ms
+) {
+    if (!wrapper || !wrapper->ptr) return -1;
+
+    SynthRequest request = MakePhraseRequest(
+        nullptr, nullptr, sample_len, sample_rate, tone,
+        velocity, offset, required_length,
+        consonant, cut_off, volume, modulation, tempo,
+        flag_g, flag_O, flag_P, flag_Mt, flag_Mb, flag_Mv);
+    request.sample_handle = (std::int64_t)sample_handle;
+
+    return PhraseSynthAddRequest(wrapper->ptr, &request, pos_ms, skip_ms, length_ms, fade_in_ms, fade_out_ms, nullptr);
+}
+
+// Returns 1 if the request with the id was replaced.
+EMSCRIPTEN_KEEPALIVE
+int worldline_phrase_synth_replace_request(
+    PhraseSynthWrapper* wrapper,
+    int id,
+    float* samples, int sample_len,
+    int sample_rate,
+    int tone,
+    double velocity, double offset, double required_length,
+    double consonant, double cut_off, double volume, double modulation, double tempo,
+    int flag_g, int flag_O, int flag_P, int flag_Mt, int flag_Mb, int flag_Mv,
+    double pos_ms, double skip_ms, double length_ms,
+    double fade_in_ms, double fade_out_ms
+) {
+    if (!wrapper || !wrapper->ptr) return 0;
+    
+    std::vector<double> buffer;
+    SynthRequest request = MakePhraseRequest(
+        samples, &buffer, sample_len, sample_rate, tone,
+        velocity, offset, required_length,
+        consonant, cut_off, volume, modulation, tempo,
+        flag_g, flag_O, flag_P, flag_Mt, flag_Mb, flag_Mv);
+    RequestTiming timing = {pos_ms, skip_ms, length_ms, fade_in_ms, fade_out_ms};
     
-    PhraseSynthAddRequest(wrapper->ptr, &request, pos_ms, skip_ms, length_ms, fade_in_ms, fade_out_ms, nullptr);
+    return PhraseSynthReplaceRequest(wrapper->ptr, id, &request, &timing, nullptr);
+}
+
+// Returns 1 if the request with the id was removed.
+EMSCRIPTEN_KEEPALIVE
+int worldline_phrase_synth_remove_request(PhraseSynthWrapper* wrapper, int id) {
+    if (!wrapper || !wrapper->ptr) return 0;
+    return PhraseSynthRemoveRequest(wrapper->ptr, id);
+}
+
+// Returns 1 if the request with the id was re-timed.
+EMSCRIPTEN_KEEPALIVE
+int worldline_phrase_synth_update_timing(
+    PhraseSynthWrapper* wrapper,
+    int id,
+    double pos_ms, double skip_ms, double length_ms,
+    double fade_in_ms, double fade_out_ms
+) {
+    if (!wrapper || !wrapper->ptr) return 0;
+    RequestTiming timing = {pos_ms, skip_ms, length_ms, fade_in_ms, fade_out_ms};
+    return PhraseSynthUpdateTiming(wrapper->ptr, id, &timing);
 }
 
 EMSCRIPTEN_KEEPALIVE
@@ -298,6 +409,88 @@ float* worldline_phrase_synth_synth(PhraseSynthWrapper* wrapper, int* out_length
     return output;
 }
 
+// Returns the total number of samples of the stream.
+EMSCRIPTEN_KEEPALIVE
+int worldline_phrase_synth_begin_stream(PhraseSynthWrapper* wrapper) {
+    if (!wrapper || !wrapper->ptr) return 0;
+    return PhraseSynthBeginStream(wrapper->ptr, nullptr);
+}
+
+// Returns the number of samples written to buf, 0 at the end of the stream.
+EMSCRIPTEN_KEEPALIVE
+int worldline_phrase_synth_read(PhraseSynthWrapper* wrapper, float* buf, int n) {
+    if (!wrapper || !wrapper->ptr) return 0;
+    return PhraseSynthRead(wrapper->ptr, buf, n);
+}
+
+// Writes bytes and peak_bytes to out[0..1].
+EMSCRIPTEN_KEEPALIVE
+void worldline_phrase_synth_get_memory_stats(PhraseSynthWrapper* wrapper, double* out) {
+    out[0] = 0;
+    out[1] = 0;
+    if (!wrapper || !wrapper->ptr) return;
+    PhraseSynthMemoryStats stats;
+    PhraseSynthGetMemoryStats(wrapper->ptr, &stats);
+    out[0] = (double)stats.bytes;
+    out[1] = (double)stats.peak_bytes;
+}
+
+// 0 for libpyin, 1 for the FFT-based pyin.
+EMSCRIPTEN_KEEPALIVE
+void worldline_f0_set_pyin_method(int method) {
+    F0SetPyinMethod(method);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void worldline_analysis_cache_set_budget(double budget_bytes) {
+    AnalysisCacheSetBudget(static_cast<std::int64_t>(budget_bytes));
+}
+
+// Writes hits, misses, evictions, entries, bytes and budget_bytes to out[0..5].
+EMSCRIPTEN_KEEPALIVE
+void worldline_analysis_cache_get_stats(double* out) {
+    AnalysisCacheStats stats;
+    AnalysisCacheGetStats(&stats);
+    out[0] = (double)stats.hits;
+    out[1] = (double)stats.misses;
+    out[2] = (double)stats.evictions;
+    out[3] = (double)stats.entries;
+    out[4] = (double)stats.bytes;
+    out[5] = (double)stats.budget_bytes;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void worldline_analysis_cache_clear() {
+    AnalysisCacheClear();
+}
+
+EMSCRIPTEN_KEEPALIVE
+int worldline_feature_store_mount(const char* path) {
+    return FeatureStoreMount(path);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void worldline_feature_store_unmount_all() {
+    FeatureStoreUnmountAll();
+}
+
+// out receives fs and length. Handles are passed as doubles, exact below
+// 2^53, since JS numbers can not hold an int64.
+EMSCRIPTEN_KEEPALIVE
+double worldline_sample_store_load(const char* path, int* out) {
+    return (double)SampleStoreLoad(path, &out[0], &out[1]);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int worldline_sample_store_retain(double handle) {
+    return SampleStoreRetain((std::int64_t)handle);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void worldline_sample_store_release(double handle) {
+    SampleStoreRelease((std::int64_t)handle);
+}
+
 EMSCRIPTEN_KEEPALIVE
 AudioDecoderWrapper* worldline_audio_decoder_init_file(const char* filename) {
     AudioDecoderWrapper* wrapper = (AudioDecoderWrapper*)malloc(sizeof(AudioDecoderWrapper));
@@ -24,7 +24,7 @@ std::unique_ptr<Resampler> create_resampler(double pitch_shift, double velocity)
         std::to_string(pitch_shift),
         std::to_string(velocity)
     };
-    return std::make_unique<Resampler>(args);
+    return Resampler::FromArgs(args);
 }
 
 EMSCRIPTEN_BINDINGS(worldline) {